@@ -29,6 +29,16 @@ struct BuildSettings
 {
     BuildSettings() = default;
 
+    /// Controls how the vector versions of sin, cos, exp, log and pow are implemented.
+    /// "exact" uses the library functions, "1ulp" uses polynomials which are within about
+    /// 1 ulp for float32 vectors, and "fast" uses polynomials in the vector's own precision.
+    enum class MathsAccuracy
+    {
+        exact,
+        oneULP,
+        fast
+    };
+
     double       getMaxFrequency() const                   { return getWithRangeCheck (maxFrequencyMember, 1.0, 1000000.0, defaultMaxFrequency); }
     double       getFrequency() const                      { return getWithRangeCheck (frequencyMember, 1.0, 1000000.0, 0.0); }
     uint32_t     getMaxBlockSize() const                   { return getWithRangeCheck (maxBlockSizeMember, 1u, 8192u, defaultMaxBlockSize); }
@@ -44,6 +54,38 @@ struct BuildSettings
     bool         shouldUseFastMaths() const                { return getOptimisationLevel() >= 4; }
     std::string  getMainProcessor() const                  { return getWithDefault (mainProcessorMember, ""); }
     double       getTransformTimeout() const               { return getWithDefault (transformTimeoutMember, defaultTransformTimeout); }
+    bool         shouldCacheObjectCode() const             { return getWithDefault (cacheObjectCodeMember, false); }
+    uint32_t     getCodeGenThreads() const                 { return getWithRangeCheck (codeGenThreadsMember, 1u, 256u, 1u); }
+    uint32_t     getRenderThreads() const                  { return getWithRangeCheck (renderThreadsMember, 1u, 256u, 1u); }
+    MathsAccuracy getMathsAccuracy() const                 { return getMathsAccuracyFromName (getWithDefault (mathsAccuracyMember, std::string())); }
+    bool         shouldInstrumentForProfiling() const      { return getWithDefault (instrumentForProfilingMember, false); }
+    bool         shouldUseProfileData() const              { return getWithDefault (useProfileDataMember, false); }
+
+    /// If true, the frequency is read from the performer's state rather than being compiled
+    /// into the code, so the same linked code can be re-used at any sample rate, and with any
+    /// block size up to getMaxBlockSize().
+    bool         shouldUseDynamicRate() const              { return getWithDefault (dynamicRateMember, false); }
+
+    /// If true, each round of the compiler's resolution passes walks the whole program,
+    /// rather than skipping modules that have already been fully resolved. This is only
+    /// useful for comparing build times, or for checking a suspected resolution bug.
+    bool         shouldUseFullResolutionPasses() const     { return getWithDefault (fullResolutionPassesMember, false); }
+
+    /// Returns an object whose members are the IDs of any input endpoints that should be
+    /// compiled as constants, holding the value that each one should be given.
+    choc::value::Value getFrozenEndpointValues() const
+    {
+        if (settings.isObject() && settings.hasObjectMember (frozenEndpointsMember))
+            return choc::value::Value (settings[frozenEndpointsMember]);
+
+        return {};
+    }
+
+    bool isEndpointFrozen (std::string_view endpointID) const
+    {
+        auto values = getFrozenEndpointValues();
+        return values.isObject() && values.hasObjectMember (endpointID);
+    }
 
     BuildSettings& setMaxFrequency (double f)              { setProperty (maxFrequencyMember, f); return *this; }
     BuildSettings& setFrequency (double f)                 { setProperty (frequencyMember, f); return *this; }
@@ -57,6 +99,28 @@ struct BuildSettings
     BuildSettings& setDebugFlag (bool b)                   { setProperty (debugMember, b); return *this; }
     BuildSettings& setMainProcessor (std::string_view s)   { setProperty (mainProcessorMember, s); return *this; }
     BuildSettings& setTransformTimeout (double f)          { setProperty (transformTimeoutMember, f); return *this; }
+    BuildSettings& setCacheObjectCode (bool b)             { setProperty (cacheObjectCodeMember, b); return *this; }
+    BuildSettings& setCodeGenThreads (uint32_t num)        { setProperty (codeGenThreadsMember, static_cast<int32_t> (num)); return *this; }
+    BuildSettings& setRenderThreads (uint32_t num)         { setProperty (renderThreadsMember, static_cast<int32_t> (num)); return *this; }
+    BuildSettings& setMathsAccuracy (MathsAccuracy a)      { setProperty (mathsAccuracyMember, getMathsAccuracyName (a)); return *this; }
+    BuildSettings& setInstrumentForProfiling (bool b)      { setProperty (instrumentForProfilingMember, b); return *this; }
+    BuildSettings& setUseProfileData (bool b)              { setProperty (useProfileDataMember, b); return *this; }
+    BuildSettings& setUseDynamicRate (bool b)              { setProperty (dynamicRateMember, b); return *this; }
+    BuildSettings& setUseFullResolutionPasses (bool b)     { setProperty (fullResolutionPassesMember, b); return *this; }
+
+    /// Makes the given input endpoint into a constant with this value. The endpoint
+    /// will no longer appear in the program's list of inputs.
+    BuildSettings& setFrozenEndpointValue (std::string_view endpointID, const choc::value::ValueView& value)
+    {
+        auto values = getFrozenEndpointValues();
+
+        if (! values.isObject())
+            values = choc::value::createObject ({});
+
+        values.setMember (endpointID, value);
+        setProperty (frozenEndpointsMember, values);
+        return *this;
+    }
 
     void reset()                                           { settings = choc::value::Value(); }
 
@@ -86,6 +150,42 @@ struct BuildSettings
         return {};
     }
 
+    /// Returns a copy of these settings without the ones that choose whether a build records
+    /// or uses a profile, so that an instrumented build and the optimised build which uses its
+    /// profile can find the profile under the same key.
+    BuildSettings withoutProfilingSettings() const
+    {
+        BuildSettings result;
+
+        if (settings.isObject())
+        {
+            for (uint32_t i = 0; i < settings.size(); ++i)
+            {
+                auto member = settings.getObjectMemberAt (i);
+                std::string_view name (member.name);
+
+                if (name != instrumentForProfilingMember && name != useProfileDataMember)
+                    result.setProperty (name, member.value);
+            }
+        }
+
+        return result;
+    }
+
+    static std::string_view getMathsAccuracyName (MathsAccuracy a)
+    {
+        if (a == MathsAccuracy::oneULP)  return "1ulp";
+        if (a == MathsAccuracy::fast)    return "fast";
+        return "exact";
+    }
+
+    static MathsAccuracy getMathsAccuracyFromName (std::string_view name)
+    {
+        if (name == "1ulp")  return MathsAccuracy::oneULP;
+        if (name == "fast")  return MathsAccuracy::fast;
+        return MathsAccuracy::exact;
+    }
+
     choc::value::Value getValue() const
     {
         return settings;
@@ -131,6 +231,15 @@ private:
     static constexpr auto debugMember              = "debug";
     static constexpr auto mainProcessorMember      = "mainProcessor";
     static constexpr auto transformTimeoutMember   = "transformTimeout";
+    static constexpr auto cacheObjectCodeMember    = "cacheObjectCode";
+    static constexpr auto codeGenThreadsMember     = "codeGenThreads";
+    static constexpr auto renderThreadsMember      = "renderThreads";
+    static constexpr auto mathsAccuracyMember      = "mathsAccuracy";
+    static constexpr auto instrumentForProfilingMember = "instrumentForProfiling";
+    static constexpr auto useProfileDataMember     = "useProfileData";
+    static constexpr auto frozenEndpointsMember    = "frozenEndpoints";
+    static constexpr auto dynamicRateMember        = "dynamicRate";
+    static constexpr auto fullResolutionPassesMember = "fullResolutionPasses";
 
     template <typename Type>
     Type getWithDefault (std::string_view name, Type defaultValue) const
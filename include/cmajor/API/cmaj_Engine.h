@@ -134,6 +134,21 @@ struct Engine
     /// program.
     Performer createPerformer();
 
+    /// Creates a new performer whose internal state is a copy of the one provided, so that
+    /// it carries on from exactly the same point without needing to be initialised or warmed up.
+    /// The source must be a performer that was created by this engine since it was last linked,
+    /// and this must be called on the source's rendering thread, between calls to advance().
+    /// Any input events or values that have been sent to the source but not yet processed by
+    /// a call to advance() are not copied.
+    /// If the engine's back-end can't copy performer state, this returns a null Performer.
+    Performer createCopyOfPerformer (const Performer& source);
+
+    /// Creates a performer that runs a number of independent instances of the program, all
+    /// of which are rendered by each call to Performer::advance(). Use
+    /// Performer::getEndpointHandleForInstance() to find the handles for each instance.
+    /// Returns a null Performer if the engine's back-end doesn't support multiple instances.
+    Performer createMultiInstancePerformer (uint32_t numInstances);
+
     /// Returns true if a program has been successfully loaded, but not yet linked.
     bool isLoaded() const;
 
@@ -398,6 +413,33 @@ inline Performer Engine::createPerformer()
     return {};
 }
 
+inline Performer Engine::createMultiInstancePerformer (uint32_t numInstances)
+{
+    // This method is only valid on a fully-linked engine
+    if (! isLinked())
+        return {};
+
+    if (auto perf = PerformerPtr (engine->createMultiInstancePerformer (numInstances)))
+        return Performer (perf);
+
+    return {};
+}
+
+inline Performer Engine::createCopyOfPerformer (const Performer& source)
+{
+    if (source == nullptr || source.getStateSize() == 0)
+        return {};
+
+    if (auto perf = createPerformer())
+    {
+        if (perf.getStateSize() == source.getStateSize()
+             && perf.restoreStateSnapshot (source.createStateSnapshot()) == Result::Ok)
+            return perf;
+    }
+
+    return {};
+}
+
 inline bool Engine::isLoaded() const    { return engine != nullptr && engine->isLoaded(); }
 inline bool Engine::isLinked() const    { return engine != nullptr && engine->isLinked(); }
 
@@ -19,6 +19,8 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
+#include <unordered_map>
 
 #include "cmaj_Program.h"
 #include "cmaj_Endpoints.h"
@@ -70,6 +72,8 @@ struct Performer
     /// You should call this function for each input stream endpoint, to provide the chunk of data that
     /// it will use in the next advance() call. The number of frames provided must be the same as the
     /// size set by the last call to setBlockSize().
+    /// If frameData is nullptr, the block is treated as silence, which is cheaper than passing a
+    /// block of zeros.
     /// The handle must have been obtained by calling getEndpointHandle() before the program is linked.
     /// It should only be called once before each advance() call.
     Result setInputFrames (EndpointHandle, const void* frameData, uint32_t numFrames);
@@ -115,6 +119,18 @@ struct Performer
     template <typename ValueType>
     Result addInputEvent (EndpointHandle, uint32_t typeIndex, const ValueType& eventValue);
 
+    /// Adds an event which will be delivered when the next advance() call reaches the given frame
+    /// within the block, so that the caller doesn't need to split its blocks at each event.
+    /// The value can be any of the types that addInputEvent() accepts.
+    /// If the back-end can't deliver events part-way through a block, this returns
+    /// Result::FrameOffsetNotSupported for any non-zero frame offset.
+    /// See PerformerInterface::addInputEventAtFrame() for more details.
+    template <typename ValueType>
+    Result addInputEventAtFrame (EndpointHandle, uint32_t typeIndex, const ValueType& eventValue, uint32_t frameOffset);
+
+    /// Returns true if addInputEventAtFrame() can deliver events part-way through a block.
+    bool supportsFrameOffsets() const;
+
     /// Copies-out the frame data from an output stream endpoint.
     /// This function must only be called on the rendering thread, after a call to advance().
     /// The handle must have been obtained by calling getEndpointHandle() before the program is linked.
@@ -139,6 +155,18 @@ struct Performer
     template <typename SampleType>
     Result copyOutputFrames (EndpointHandle, choc::buffer::InterleavedBuffer<SampleType>& destBuffer) const;
 
+    /// Returns a pointer to the performer's internal frame buffer for a stream endpoint, so that
+    /// frames can be written or read in-place instead of being copied by setInputFrames() or
+    /// copyOutputFrames(). Returns nullptr if the back-end can't provide direct access to the endpoint.
+    /// See PerformerInterface::getStreamBuffer() for the rules about when the data is valid.
+    void* getStreamBuffer (EndpointHandle, uint32_t& frameStride) const;
+
+    /// This is a helper function that calls getStreamBuffer() and returns an audio buffer view of
+    /// the endpoint's frames. If direct access isn't possible, or the endpoint's frames aren't
+    /// made of numChannels samples of the given type, it returns an empty view.
+    template <typename SampleType>
+    choc::buffer::InterleavedView<SampleType> getStreamBufferView (EndpointHandle, uint32_t numChannels) const;
+
     /// Copies-out the data for the current value of an output value endpoint.
     /// This function must only be called on the rendering thread, after a call to advance().
     /// The handle must have been obtained by calling getEndpointHandle() before the program is linked.
@@ -163,6 +191,15 @@ struct Performer
     /// The number of frames rendered will be the number that was last specified by a call to setBlockSize().
     Result advance();
 
+    /// Registers the input and output endpoints whose data will be passed to processBlock().
+    /// This may allocate memory, so must not be called on the rendering thread.
+    /// See PerformerInterface::setBlockBindings() for more details.
+    Result setBlockBindings (const std::vector<EndpointHandle>& inputs, const std::vector<EndpointHandle>& outputs);
+
+    /// Renders a block in a single call, passing the data for the endpoints that were registered
+    /// with setBlockBindings(). See PerformerInterface::processBlock() for more details.
+    Result processBlock (uint32_t numFrames, const void* const* inputData, void* const* outputData);
+
     /// Retrieves the string from a handle used in the current program, or an empty string if not found.
     std::string_view getStringForHandle (uint32_t handle) const;
 
@@ -183,12 +220,55 @@ struct Performer
     /// If there has been a runtime error, this returns the message, or nullptr if there isn't one.
     const char* getRuntimeError() const;
 
+    /// For a performer created by Engine::createMultiInstancePerformer(), this returns the
+    /// handle that refers to the given endpoint in one of its instances, or 0 if the handle
+    /// or instance index is out of range. Instance 0 always uses the engine's own handles.
+    EndpointHandle getEndpointHandleForInstance (EndpointHandle, uint32_t instanceIndex) const;
+
+    //==============================================================================
+    /// Returns the number of bytes needed to hold a copy of the performer's internal state,
+    /// or 0 if the state can't be copied.
+    uint64_t getStateSize() const;
+
+    /// Copies the performer's current internal state into a buffer of getStateSize() bytes.
+    /// This must only be called on the rendering thread, between calls to advance().
+    Result copyState (void* dest) const;
+
+    /// Replaces the performer's internal state with data that was obtained by calling
+    /// copyState() on a performer for the same program and build settings.
+    /// This must only be called on the rendering thread, between calls to advance().
+    Result setState (const void* source, uint64_t size);
+
+    /// Returns a snapshot of the performer's current internal state, which can later be
+    /// passed to restoreState() on this or any other performer for the same program.
+    /// Returns an empty vector if the state can't be copied.
+    /// This must only be called on the rendering thread, between calls to advance().
+    std::vector<uint8_t> createStateSnapshot() const;
+
+    /// Restores a snapshot that was returned by createStateSnapshot().
+    /// This must only be called on the rendering thread, between calls to advance().
+    Result restoreStateSnapshot (const std::vector<uint8_t>& snapshot);
+
+    /// Returns the layout of the performer's state variables (see PerformerInterface::getStateLayout()),
+    /// or a void value if it isn't available.
+    choc::value::Value getStateLayout() const;
+
+    /// Copies any state variables whose names and types are the same in both performers from
+    /// the source into this one, leaving the rest of this performer's state as it is. This lets a
+    /// performer that was built from an edited version of a program carry on from where an older
+    /// one was, e.g. with its delay lines and envelopes intact.
+    /// This must only be called on the rendering thread, between calls to advance().
+    Result copyMatchingStateFrom (const Performer& source);
+
     //==============================================================================
     /// The underlying performer that this helper object is wrapping.
     PerformerPtr performer;
 
 private:
     Library::SharedLibraryPtr library;
+
+    template <typename ValueType, typename AddEventFn>
+    static Result withRawEventData (const ValueType&, AddEventFn&&);
 };
 
 
@@ -270,6 +350,18 @@ Result Performer::setInputValue (EndpointHandle e, const ValueType& newValue, ui
 
 template <typename ValueType>
 Result Performer::addInputEvent (EndpointHandle e, uint32_t type, const ValueType& value)
+{
+    return withRawEventData (value, [&] (const void* data) { return performer->addInputEvent (e, type, data); });
+}
+
+template <typename ValueType>
+Result Performer::addInputEventAtFrame (EndpointHandle e, uint32_t type, const ValueType& value, uint32_t frameOffset)
+{
+    return withRawEventData (value, [&] (const void* data) { return performer->addInputEventAtFrame (e, type, data, frameOffset); });
+}
+
+template <typename ValueType, typename AddEventFn>
+Result Performer::withRawEventData (const ValueType& value, AddEventFn&& addEvent)
 {
     static_assert (std::is_same<const ValueType, const int32_t>::value
                    || std::is_same<const ValueType, const int64_t>::value
@@ -288,22 +380,22 @@ Result Performer::addInputEvent (EndpointHandle e, uint32_t type, const ValueTyp
                    || std::is_same<const ValueType, const double>::value)
     {
         ValueType v = value;
-        return performer->addInputEvent (e, type, std::addressof (v));
+        return addEvent (std::addressof (v));
     }
     else if constexpr (std::is_same<const ValueType, const void* const>::value
                         || std::is_same<const ValueType, const char* const>::value)
     {
-        return performer->addInputEvent (e, type, value);
+        return addEvent (value);
     }
     else if constexpr (std::is_same<const ValueType, const bool>::value)
     {
         int32_t v = value ? 1 : 0;
-        return performer->addInputEvent (e, type, std::addressof (v));
+        return addEvent (std::addressof (v));
     }
     else if constexpr (std::is_same<const ValueType, const choc::value::ValueView>::value
                         || std::is_same<const ValueType, const choc::value::Value>::value)
     {
-        return performer->addInputEvent (e, type, value.getRawData());
+        return addEvent (value.getRawData());
     }
 }
 
@@ -329,6 +421,23 @@ Result Performer::copyOutputFrames (EndpointHandle endpoint, choc::buffer::Inter
     return performer->copyOutputFrames (endpoint, destBuffer.getView().data.data, destBuffer.getNumFrames());
 }
 
+inline void* Performer::getStreamBuffer (EndpointHandle endpoint, uint32_t& frameStride) const
+{
+    return performer->getStreamBuffer (endpoint, frameStride);
+}
+
+template <typename SampleType>
+choc::buffer::InterleavedView<SampleType> Performer::getStreamBufferView (EndpointHandle endpoint, uint32_t numChannels) const
+{
+    uint32_t frameStride = 0;
+
+    if (auto buffer = performer->getStreamBuffer (endpoint, frameStride))
+        if (frameStride == numChannels * sizeof (SampleType))
+            return choc::buffer::createInterleavedView (static_cast<SampleType*> (buffer), numChannels, getMaximumBlockSize());
+
+    return {};
+}
+
 template <typename HandlerFn>
 inline Result Performer::iterateOutputEvents (EndpointHandle endpoint, HandlerFn&& handler)
 {
@@ -355,6 +464,17 @@ inline Result Performer::advance()
     return performer->advance();
 }
 
+inline Result Performer::setBlockBindings (const std::vector<EndpointHandle>& inputs, const std::vector<EndpointHandle>& outputs)
+{
+    return performer->setBlockBindings (inputs.data(), static_cast<uint32_t> (inputs.size()),
+                                        outputs.data(), static_cast<uint32_t> (outputs.size()));
+}
+
+inline Result Performer::processBlock (uint32_t numFrames, const void* const* inputData, void* const* outputData)
+{
+    return performer->processBlock (numFrames, inputData, outputData);
+}
+
 inline std::string_view Performer::getStringForHandle (uint32_t handle) const
 {
     size_t length;
@@ -369,7 +489,109 @@ inline uint32_t Performer::getXRuns() const             { return performer != nu
 inline uint32_t Performer::getMaximumBlockSize() const  { return performer->getMaximumBlockSize(); }
 inline double Performer::getLatency() const             { return performer->getLatency(); }
 inline uint32_t Performer::getEventBufferSize() const   { return performer->getEventBufferSize(); }
+inline bool Performer::supportsFrameOffsets() const     { return performer->supportsFrameOffsets(); }
 inline const char* Performer::getRuntimeError() const   { return performer != nullptr ? performer->getRuntimeError() : nullptr; }
 
+inline EndpointHandle Performer::getEndpointHandleForInstance (EndpointHandle handle, uint32_t instanceIndex) const
+{
+    return performer->getEndpointHandleForInstance (handle, instanceIndex);
+}
+inline uint64_t Performer::getStateSize() const         { return performer != nullptr ? performer->getStateSize() : 0; }
+inline Result Performer::copyState (void* dest) const   { return performer->copyState (dest); }
+inline Result Performer::setState (const void* source, uint64_t size)  { return performer->setState (source, size); }
+
+inline std::vector<uint8_t> Performer::createStateSnapshot() const
+{
+    std::vector<uint8_t> snapshot;
+
+    if (auto size = getStateSize())
+    {
+        snapshot.resize (static_cast<size_t> (size));
+
+        if (copyState (snapshot.data()) != Result::Ok)
+            snapshot.clear();
+    }
+
+    return snapshot;
+}
+
+inline Result Performer::restoreStateSnapshot (const std::vector<uint8_t>& snapshot)
+{
+    if (snapshot.empty())
+        return Result::InvalidState;
+
+    return setState (snapshot.data(), snapshot.size());
+}
+
+inline choc::value::Value Performer::getStateLayout() const
+{
+    if (performer != nullptr)
+        if (auto layout = performer->getStateLayout())
+            return choc::json::parse (layout);
+
+    return {};
+}
+
+inline Result Performer::copyMatchingStateFrom (const Performer& source)
+{
+    auto sourceLayout = source.getStateLayout();
+    auto destLayout = getStateLayout();
+
+    if (! (sourceLayout.isObject() && sourceLayout["variables"].isArray()
+            && destLayout.isObject() && destLayout["variables"].isArray()))
+        return Result::InvalidState;
+
+    auto sourceInstanceSize = static_cast<size_t> (sourceLayout["instanceSize"].getWithDefault<int64_t> (0));
+    auto destInstanceSize   = static_cast<size_t> (destLayout["instanceSize"].getWithDefault<int64_t> (0));
+
+    auto sourceState = source.createStateSnapshot();
+    auto destState = createStateSnapshot();
+
+    if (sourceInstanceSize == 0 || destInstanceSize == 0 || sourceState.empty() || destState.empty())
+        return Result::InvalidState;
+
+    struct Variable
+    {
+        std::string type;
+        size_t offset, size;
+    };
+
+    auto getVariable = [] (const choc::value::ValueView& v)
+    {
+        return Variable { v["type"].getWithDefault<std::string> ({}),
+                          static_cast<size_t> (v["offset"].getWithDefault<int64_t> (0)),
+                          static_cast<size_t> (v["size"].getWithDefault<int64_t> (0)) };
+    };
+
+    std::unordered_map<std::string, Variable> sourceVariables;
+
+    for (auto v : sourceLayout["variables"])
+        sourceVariables[v["name"].getWithDefault<std::string> ({})] = getVariable (v);
+
+    auto numInstances = std::min (sourceState.size() / sourceInstanceSize,
+                                  destState.size() / destInstanceSize);
+
+    for (auto v : destLayout["variables"])
+    {
+        auto dest = getVariable (v);
+        auto sourceVariable = sourceVariables.find (v["name"].getWithDefault<std::string> ({}));
+
+        if (sourceVariable == sourceVariables.end())
+            continue;
+
+        auto& src = sourceVariable->second;
+
+        if (src.type != dest.type || src.size != dest.size
+             || src.offset + src.size > sourceInstanceSize || dest.offset + dest.size > destInstanceSize)
+            continue;
+
+        for (size_t i = 0; i < numInstances; ++i)
+            std::memcpy (destState.data() + i * destInstanceSize + dest.offset,
+                         sourceState.data() + i * sourceInstanceSize + src.offset, dest.size);
+    }
+
+    return restoreStateSnapshot (destState);
+}
+
 
 } // namespace cmaj
@@ -150,6 +150,16 @@ struct EngineInterface   : public choc::com::Object
 
     /// Returns a space-separated list of available code-gen targets
     virtual const char* getAvailableCodeGenTargetTypes() = 0;
+
+    //==============================================================================
+    /// Creates a performer that runs a number of independent instances of the linked program,
+    /// and renders all of them in each call to advance().
+    /// Each instance has its own set of endpoint handles, which the caller can get by passing
+    /// the engine's handles to PerformerInterface::getEndpointHandleForInstance(). Instance 0
+    /// uses the engine's handles themselves.
+    /// Returns nullptr if the engine isn't linked, or if its back-end doesn't support
+    /// more than one instance per performer.
+    [[nodiscard]] virtual PerformerInterface* createMultiInstancePerformer (uint32_t numInstances) = 0;
 };
 
 using EnginePtr = choc::com::Ptr<EngineInterface>;
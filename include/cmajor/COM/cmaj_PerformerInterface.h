@@ -71,6 +71,9 @@ struct PerformerInterface   : public choc::com::Object
     /// You should call this function for each input stream endpoint, to provide the chunk of data that
     /// it will use in the next advance() call. The number of frames provided must be the same as the
     /// size set by the last call to setBlockSize().
+    /// If frameData is nullptr, the block is treated as silence. This is cheaper than passing a block
+    /// of zeros, because a performer only needs to clear its buffer when the stream's previous block
+    /// wasn't also silent.
     /// The handle must have been obtained by calling getEndpointHandle() before the program is linked.
     /// It should only be called once before each advance() call.
     virtual Result setInputFrames (EndpointHandle, const void* frameData, uint32_t numFrames) = 0;
@@ -148,6 +151,88 @@ struct PerformerInterface   : public choc::com::Object
 
     /// If there has been a runtime error, this returns the message, or nullptr if there isn't one.
     virtual const char* getRuntimeError() = 0;
+
+    /// For a performer created by EngineInterface::createMultiInstancePerformer(), this takes
+    /// one of the engine's endpoint handles and returns the handle that refers to the same
+    /// endpoint in the given instance. Instance 0 always uses the engine's own handles.
+    /// Returns 0 if the handle or instance index is out of range.
+    virtual EndpointHandle getEndpointHandleForInstance (EndpointHandle, uint32_t instanceIndex) = 0;
+
+    /// Returns the number of bytes needed to hold a copy of the performer's internal state,
+    /// or 0 if this performer's state can't be copied (e.g. because the back-end doesn't
+    /// support it, or the state contains pointers that are only valid within this instance).
+    /// For a multi-instance performer, this covers the states of all its instances.
+    virtual uint64_t getStateSize() = 0;
+
+    /// Copies the performer's current internal state into a buffer of getStateSize() bytes.
+    /// This must only be called on the rendering thread, between calls to advance().
+    virtual Result copyState (void* dest) = 0;
+
+    /// Replaces the performer's internal state with some data that was obtained by calling
+    /// copyState() on a performer for the same program and build settings. The state layout
+    /// doesn't depend on the optimisation level, so the data can come from a performer that
+    /// was built at a different level.
+    /// This must only be called on the rendering thread, between calls to advance().
+    virtual Result setState (const void* source, uint64_t size) = 0;
+
+    /// Returns a JSON object describing where the program's state variables live within the
+    /// data that copyState() produces, or nullptr if this isn't available. It has an "instanceSize"
+    /// property, and a "variables" array of objects with "name", "type", "offset" and "size"
+    /// properties. For a multi-instance performer, this describes the state of one instance,
+    /// and the states of the instances follow each other, each instanceSize bytes long.
+    /// Names and types can be matched against the layout of a performer built from an edited
+    /// version of the program, to carry over any variables that haven't changed.
+    virtual const char* getStateLayout() = 0;
+
+    /// Returns a pointer to the performer's internal frame buffer for a stream endpoint, so that
+    /// the caller can write input frames or read output frames in-place rather than copying them
+    /// with setInputFrames() or copyOutputFrames().
+    /// If the back-end can't provide direct access to this endpoint (e.g. because its internal
+    /// frame layout differs from the packed choc::value format), this returns nullptr, and the
+    /// caller must use the copying functions instead. Otherwise, frameStride is set to the number
+    /// of bytes between consecutive frames, and the buffer has space for getMaximumBlockSize() frames.
+    /// The pointer remains valid for the lifetime of the performer, and should be obtained before
+    /// rendering starts rather than on the rendering thread.
+    /// For an input stream, the caller must write the frames for the next block before each call to
+    /// advance(), because the performer doesn't preserve them. For an output stream, the frames are
+    /// valid after advance() until the next call to advance() or reset(), and once a pointer has been
+    /// requested, the performer will clear the buffer itself at the start of each advance() call.
+    virtual void* getStreamBuffer (EndpointHandle, uint32_t& frameStride) = 0;
+
+    /// Registers the endpoints whose data will be passed to processBlock().
+    /// The inputs can be input stream or value endpoints, and the outputs can be output stream or
+    /// value endpoints. The order of the handles sets the order of the data pointers that must be
+    /// passed to processBlock(). Any previously registered bindings are replaced.
+    /// This may allocate memory, so it must not be called on the rendering thread.
+    virtual Result setBlockBindings (const EndpointHandle* inputs, uint32_t numInputs,
+                                     const EndpointHandle* outputs, uint32_t numOutputs) = 0;
+
+    /// Renders a block using the endpoints that were registered with setBlockBindings().
+    /// This does the same as calling setBlockSize(), then setInputFrames() or setInputValue() for each
+    /// bound input, then advance(), then copyOutputFrames() or copyOutputValue() for each bound output,
+    /// but in a single call.
+    /// The inputData and outputData arrays must contain one pointer for each bound endpoint, in the
+    /// order in which they were registered. As with setInputFrames(), a nullptr entry for a stream
+    /// input means a block of silence. For a value input or an output, a nullptr entry skips that
+    /// endpoint for this block, which is handy for values that haven't changed. Values are applied
+    /// without any ramping.
+    /// Any output events must still be read with iterateOutputEvents().
+    virtual Result processBlock (uint32_t numFrames, const void* const* inputData, void* const* outputData) = 0;
+
+    /// Adds an event which will be delivered part-way through the next block.
+    /// This works like addInputEvent(), but the event is queued and then dispatched when the
+    /// next advance() call reaches the given frame, so a host doesn't need to split its blocks
+    /// at each event's timestamp. Events for the same frame are delivered in the order they were
+    /// added, and a frame offset beyond the end of the block is treated as its last frame.
+    /// Each instance can queue up to getEventBufferSize() events per block: any more than that
+    /// are dropped and counted as an xrun.
+    /// A frame offset of 0 is always accepted. If the back-end can't deliver events part-way
+    /// through a block (see supportsFrameOffsets()), it returns Result::FrameOffsetNotSupported
+    /// for any other offset.
+    virtual Result addInputEventAtFrame (EndpointHandle, uint32_t typeIndex, const void* eventData, uint32_t frameOffset) = 0;
+
+    /// Returns true if addInputEventAtFrame() can deliver events part-way through a block.
+    virtual bool supportsFrameOffsets() = 0;
 };
 
 using PerformerPtr = choc::com::Ptr<PerformerInterface>;
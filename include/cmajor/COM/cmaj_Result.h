@@ -30,7 +30,9 @@ enum class Result : int32_t
     Ok = 0,
     InvalidEndpointHandle   = -1,
     InvalidBlockSize        = -2,
-    TypeIndexOutOfRange     = -3
+    TypeIndexOutOfRange     = -3,
+    InvalidState            = -4,
+    FrameOffsetNotSupported = -5
 };
 
 }
\ No newline at end of file
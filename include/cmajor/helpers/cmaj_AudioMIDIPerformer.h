@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
 
@@ -113,6 +114,12 @@ struct AudioMIDIPerformer
     /// and before beginning calls to process()
     bool prepareToStart();
 
+    /// Replaces the performer with another one for the same program (e.g. one created from a
+    /// rebuilt engine), leaving the old one in the object that was passed in. This must not be
+    /// called while process() is running, but is cheap enough to call while holding a lock that
+    /// the audio thread may be waiting for.
+    bool swapPerformer (cmaj::Performer&);
+
     /// If 'replace' is true, it overwrites the output buffer and clears any channels that
     /// aren't in use. If false, it will add the output to whatever is already in the buffer.
     bool process (const choc::audio::AudioMIDIBlockDispatcher::Block&, bool replaceOutput);
@@ -158,9 +165,22 @@ private:
     choc::buffer::InterleavingScratchBuffer<float> audioInputScratchBuffer;
     std::vector<uint8_t> audioOutputScratchSpace;
 
+    // The performer's own buffers for the audio stream endpoints, which are fetched when the
+    // performer is set, rather than on the audio thread. The data is null if the performer
+    // can't provide direct access, in which case its frames are copied.
+    struct StreamBuffer
+    {
+        EndpointHandle endpoint;
+        uint32_t frameSize;
+        void* data = nullptr;
+    };
+
+    std::vector<StreamBuffer> streamBuffers;
+
     uint64_t numFramesProcessed = 0;
     static constexpr uint32_t maxFramesPerBlock = 512;
     uint32_t currentMaxBlockSize = 0;
+    bool canAddEventsAtFrame = false;
 
     std::atomic<uint32_t> processCallCount { 0 };
     uint32_t lastCheckedProcessCallCount = 0;
@@ -171,8 +191,19 @@ private:
     AudioMIDIPerformer (cmaj::Engine, uint32_t eventFIFOSize);
 
     void allocateScratch();
+    size_t addStreamBuffer (EndpointHandle, uint32_t frameSize);
+    void updateStreamBuffers();
+
+    template <typename SampleType>
+    choc::buffer::InterleavedView<SampleType> getStreamBufferView (size_t streamBufferIndex, uint32_t numChannels, uint32_t numFrames) const;
+
+    bool process (const choc::audio::AudioMIDIBlockDispatcher::Block&, bool replaceOutput, const int* midiMessageFrames);
     void dispatchMIDIOutputEvents (const choc::audio::AudioMIDIBlockDispatcher::Block&);
     void moveOutputEventsToQueue();
+
+    template <typename SampleType>
+    choc::buffer::InterleavedView<SampleType> readOutputFrames (EndpointHandle, size_t streamBufferIndex,
+                                                                const choc::buffer::InterleavedView<SampleType>& scratch, uint32_t numFrames);
 };
 
 
@@ -250,22 +281,41 @@ inline bool AudioMIDIPerformer::Builder::connectAudioInputTo (const std::vector<
     {
         ensureInputScratchBufferChannelCount (numChannelsInEndpoint);
         auto endpointHandle = result->engine.getEndpointHandle (endpoint.endpointID);
+        auto streamBufferIndex = result->addStreamBuffer (endpointHandle, numChannelsInEndpoint * static_cast<uint32_t> (sizeof (float)));
+
+        // The performer doesn't keep its input frames between blocks, so any channels that
+        // nothing is connected to must be cleared each time
+        std::vector<uint32_t> unconnectedChannels;
+
+        for (uint32_t i = 0; i < numChannelsInEndpoint; ++i)
+            if (std::find (endpointChannels.begin(), endpointChannels.end(), i) == endpointChannels.end())
+                unconnectedChannels.push_back (i);
 
-        result->preRenderFunctions.push_back ([amp = result.get(), endpointHandle, numChannelsInEndpoint,
-                                               endpointChannels, inputChannels, listener]
+        result->preRenderFunctions.push_back ([amp = result.get(), endpointHandle, streamBufferIndex, numChannelsInEndpoint,
+                                               endpointChannels, inputChannels, unconnectedChannels, listener]
                                               (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
         {
             auto numFrames = block.audioInput.getNumFrames();
-            auto interleavedBuffer = amp->audioInputScratchBuffer.getInterleavedBuffer ({ numChannelsInEndpoint, numFrames });
+
+            // If the performer lets us write to its input buffer in-place, we can skip the scratch buffer
+            auto directBuffer = amp->getStreamBufferView<float> (streamBufferIndex, numChannelsInEndpoint, numFrames);
+            bool isDirect = directBuffer.data.data != nullptr;
+
+            auto interleavedBuffer = isDirect ? directBuffer
+                                              : amp->audioInputScratchBuffer.getInterleavedBuffer ({ numChannelsInEndpoint, numFrames });
 
             for (uint32_t i = 0; i < inputChannels.size(); i++)
                 copy (interleavedBuffer.getChannel (endpointChannels[i]),
                         block.audioInput.getChannel (inputChannels[i]));
 
+            for (auto chan : unconnectedChannels)
+                interleavedBuffer.getChannel (chan).clear();
+
             if (listener)
                 listener->process (interleavedBuffer);
 
-            amp->performer.setInputFrames (endpointHandle, interleavedBuffer.data.data, numFrames);
+            if (! isDirect)
+                amp->performer.setInputFrames (endpointHandle, interleavedBuffer.data.data, numFrames);
         });
 
         return true;
@@ -337,27 +387,25 @@ void AudioMIDIPerformer::Builder::addOutputCopyFunction (EndpointHandle endpoint
     auto scratch = choc::buffer::createInterleavedView (reinterpret_cast<SampleType*> (result->audioOutputScratchSpace.data()),
                                                         numChannelsInEndpoint, maxFramesPerBlock);
 
+    auto streamBufferIndex = result->addStreamBuffer (endpointHandle, numChannelsInEndpoint * static_cast<uint32_t> (sizeof (SampleType)));
+
     if (endpointChannels.empty())
     {
         if (listener)
         {
-            result->postRenderAddFunctions.push_back ([amp = result.get(), endpointHandle, scratch, listener]
+            result->postRenderAddFunctions.push_back ([amp = result.get(), endpointHandle, streamBufferIndex, scratch, listener]
                                                       (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
             {
                 auto destSize = block.audioOutput.getSize();
-                auto source = scratch.getStart (destSize.numFrames);
-
-                amp->performer.copyOutputFrames (endpointHandle, source);
+                auto source = amp->readOutputFrames (endpointHandle, streamBufferIndex, scratch, destSize.numFrames);
                 listener->process (source);
             });
 
-            result->postRenderReplaceFunctions.push_back ([amp = result.get(), endpointHandle, scratch, listener]
+            result->postRenderReplaceFunctions.push_back ([amp = result.get(), endpointHandle, streamBufferIndex, scratch, listener]
                                                           (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
             {
                 auto destSize = block.audioOutput.getSize();
-                auto source = scratch.getStart (destSize.numFrames);
-
-                amp->performer.copyOutputFrames (endpointHandle, source);
+                auto source = amp->readOutputFrames (endpointHandle, streamBufferIndex, scratch, destSize.numFrames);
                 listener->process (source);
             });
         }
@@ -393,13 +441,11 @@ void AudioMIDIPerformer::Builder::addOutputCopyFunction (EndpointHandle endpoint
         allMappings.push_back ({ src, dest });
     }
 
-    result->postRenderAddFunctions.push_back ([amp = result.get(), endpointHandle, scratch, allMappings, listener]
+    result->postRenderAddFunctions.push_back ([amp = result.get(), endpointHandle, streamBufferIndex, scratch, allMappings, listener]
                                               (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
     {
         auto destSize = block.audioOutput.getSize();
-        auto source = scratch.getStart (destSize.numFrames);
-
-        amp->performer.copyOutputFrames (endpointHandle, source);
+        auto source = amp->readOutputFrames (endpointHandle, streamBufferIndex, scratch, destSize.numFrames);
 
         if (listener)
             listener->process (source);
@@ -453,13 +499,11 @@ void AudioMIDIPerformer::Builder::addOutputCopyFunction (EndpointHandle endpoint
     }
     else
     {
-        result->postRenderReplaceFunctions.push_back ([amp = result.get(), endpointHandle, scratch, channelsToOverwrite, channelsToAddTo, listener]
+        result->postRenderReplaceFunctions.push_back ([amp = result.get(), endpointHandle, streamBufferIndex, scratch, channelsToOverwrite, channelsToAddTo, listener]
                                                       (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
         {
             auto destSize = block.audioOutput.getSize();
-            auto source = scratch.getStart (destSize.numFrames);
-
-            amp->performer.copyOutputFrames (endpointHandle, source);
+            auto source = amp->readOutputFrames (endpointHandle, streamBufferIndex, scratch, destSize.numFrames);
 
             if (listener)
                 listener->process (source);
@@ -577,6 +621,50 @@ inline void AudioMIDIPerformer::allocateScratch()
         audioOutputScratchSpace.resize (scratchNeeded);
 }
 
+inline size_t AudioMIDIPerformer::addStreamBuffer (EndpointHandle endpoint, uint32_t frameSize)
+{
+    streamBuffers.push_back ({ endpoint, frameSize, nullptr });
+    return streamBuffers.size() - 1;
+}
+
+inline void AudioMIDIPerformer::updateStreamBuffers()
+{
+    for (auto& b : streamBuffers)
+    {
+        uint32_t frameStride = 0;
+        b.data = performer.getStreamBuffer (b.endpoint, frameStride);
+
+        if (frameStride != b.frameSize)
+            b.data = nullptr;
+    }
+}
+
+template <typename SampleType>
+choc::buffer::InterleavedView<SampleType> AudioMIDIPerformer::getStreamBufferView (size_t streamBufferIndex, uint32_t numChannels, uint32_t numFrames) const
+{
+    if (auto data = streamBuffers[streamBufferIndex].data)
+        return choc::buffer::createInterleavedView (static_cast<SampleType*> (data), numChannels, numFrames);
+
+    return {};
+}
+
+template <typename SampleType>
+choc::buffer::InterleavedView<SampleType> AudioMIDIPerformer::readOutputFrames (EndpointHandle endpointHandle,
+                                                                                size_t streamBufferIndex,
+                                                                                const choc::buffer::InterleavedView<SampleType>& scratch,
+                                                                                uint32_t numFrames)
+{
+    // If the performer lets us read its output buffer in-place, there's no need to copy it into the scratch space
+    auto directBuffer = getStreamBufferView<SampleType> (streamBufferIndex, scratch.getNumChannels(), numFrames);
+
+    if (directBuffer.data.data != nullptr)
+        return directBuffer;
+
+    auto source = scratch.getStart (numFrames);
+    performer.copyOutputFrames (endpointHandle, source);
+    return source;
+}
+
 template <typename Fifo, typename Fn>
 static bool pushWithTimeout (Fifo& fifo, uint32_t totalSize, uint32_t timeoutMilliseconds, Fn&& f)
 {
@@ -679,24 +767,41 @@ inline bool AudioMIDIPerformer::postEventOrValue (const cmaj::EndpointID& endpoi
 //==============================================================================
 inline bool AudioMIDIPerformer::prepareToStart()
 {
-    performer = engine.createPerformer();
+    auto newPerformer = engine.createPerformer();
+    return swapPerformer (newPerformer);
+}
 
-    if (performer == nullptr)
+inline bool AudioMIDIPerformer::swapPerformer (cmaj::Performer& newPerformer)
+{
+    if (newPerformer == nullptr)
         return false;
 
+    std::swap (performer, newPerformer);
+    updateStreamBuffers();
+
     currentMaxBlockSize = std::min (maxFramesPerBlock, performer.getMaximumBlockSize());
     midiOutputMessages.reserve (midiOutputEndpoints.size() * performer.getEventBufferSize());
     endpointTypeCoercionHelpers.initialiseDictionary (performer);
+    canAddEventsAtFrame = ! midiInputEndpoints.empty() && performer.supportsFrameOffsets();
     return true;
 }
 
 inline void AudioMIDIPerformer::playbackStopped()
 {
     performer = {};
+
+    for (auto& b : streamBuffers)
+        b.data = nullptr;
 }
 
 //==============================================================================
 inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispatcher::Block& block, bool replaceOutput)
+{
+    return process (block, replaceOutput, nullptr);
+}
+
+inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispatcher::Block& block, bool replaceOutput,
+                                         const int* midiMessageFrames)
 {
     try
     {
@@ -750,8 +855,9 @@ inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispat
 
         if (! midiInputEndpoints.empty())
         {
-            for (auto midiEvent : block.midiMessages)
+            for (size_t index = 0; index < block.midiMessages.size(); ++index)
             {
+                auto& midiEvent = block.midiMessages[index];
                 auto length = midiEvent.message.length();
 
                 if (length < 4 && length != 0)
@@ -762,8 +868,18 @@ inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispat
                     for (uint32_t i = 0; i < length; ++i)
                         packedMIDI = (packedMIDI << 8) | static_cast<int32_t> (bytes[i]);
 
-                    for (auto& midiEndpoint : midiInputEndpoints)
-                        performer.addInputEvent (midiEndpoint, 0, packedMIDI);
+                    if (midiMessageFrames != nullptr)
+                    {
+                        auto frame = static_cast<uint32_t> (std::max (0, midiMessageFrames[index]));
+
+                        for (auto& midiEndpoint : midiInputEndpoints)
+                            performer.addInputEventAtFrame (midiEndpoint, 0, packedMIDI, frame);
+                    }
+                    else
+                    {
+                        for (auto& midiEndpoint : midiInputEndpoints)
+                            performer.addInputEvent (midiEndpoint, 0, packedMIDI);
+                    }
                 }
             }
         }
@@ -810,6 +926,20 @@ inline bool AudioMIDIPerformer::processWithTimeStampedMIDI (const choc::buffer::
     if (totalNumMIDIMessages == 0)
         return process (choc::audio::AudioMIDIBlockDispatcher::Block { audioInput, audioOutput, {}, sendMidiOut }, replaceOutput);
 
+    // If the performer can deliver the events at the right frames itself, there's no need to chop up
+    // the block. Its queue only holds getEventBufferSize() events per block though, so a burst of
+    // MIDI that could overflow it is split into chunks, which never drop anything
+    if (canAddEventsAtFrame
+         && audioOutput.getNumFrames() <= currentMaxBlockSize
+         && totalNumMIDIMessages * midiInputEndpoints.size() <= performer.getEventBufferSize())
+        return process (choc::audio::AudioMIDIBlockDispatcher::Block
+                        {
+                            audioInput,
+                            audioOutput,
+                            choc::span<const choc::audio::AudioMIDIBlockDispatcher::MIDIMessage> (midiInMessages, midiInMessages + totalNumMIDIMessages),
+                            sendMidiOut
+                        }, replaceOutput, midiInMessageTimes);
+
     auto remainingChunk = audioOutput.getFrameRange();
     uint32_t midiStartIndex = 0;
 
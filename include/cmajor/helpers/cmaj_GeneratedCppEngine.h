@@ -88,6 +88,15 @@ struct GeneratedCppEngine  : public choc::com::ObjectWithAtomicRefCount<EngineIn
         return choc::com::create<Performer> (getSessionID(), getFrequency()).getWithIncrementedRefCount();
     }
 
+    PerformerInterface* createMultiInstancePerformer (uint32_t numInstances) override
+    {
+        // each generated class object is a single instance of the program
+        if (numInstances == 1)
+            return createPerformer();
+
+        return {};
+    }
+
     //==============================================================================
     choc::com::String* getProgramDetails() override
     {
@@ -158,8 +167,12 @@ private:
 
         Result setInputFrames (EndpointHandle endpoint, const void* frameData, uint32_t numFrames) override
         {
-            generatedObject.setInputFrames (endpoint, frameData, numFrames,
-                                            currentBlockSize > numFrames ? currentBlockSize - numFrames : 0);
+            if (frameData == nullptr)
+                generatedObject.setInputFrames (endpoint, nullptr, 0, currentBlockSize);
+            else
+                generatedObject.setInputFrames (endpoint, frameData, numFrames,
+                                                currentBlockSize > numFrames ? currentBlockSize - numFrames : 0);
+
             return Result::Ok;
         }
 
@@ -175,6 +188,15 @@ private:
             return Result::Ok;
         }
 
+        Result addInputEventAtFrame (EndpointHandle endpoint, uint32_t typeIndex, const void* eventData, uint32_t frameOffset) override
+        {
+            // The generated class has no way to stop part-way through a block
+            if (frameOffset != 0)
+                return Result::FrameOffsetNotSupported;
+
+            return addInputEvent (endpoint, typeIndex, eventData);
+        }
+
         Result copyOutputValue (EndpointHandle endpoint, void* dest) override
         {
             generatedObject.copyOutputValue (endpoint, dest);
@@ -213,6 +235,87 @@ private:
             return Result::Ok;
         }
 
+        Result setBlockBindings (const EndpointHandle* inputs, uint32_t numInputs,
+                                 const EndpointHandle* outputs, uint32_t numOutputs) override
+        {
+            auto details = choc::json::parse (GeneratedCppClass::programDetailsJSON);
+
+            auto findBindings = [] (const EndpointDetailsList& endpoints, const EndpointHandle* handles,
+                                    uint32_t numHandles, std::vector<Binding>& result)
+            {
+                for (uint32_t i = 0; i < numHandles; ++i)
+                {
+                    bool found = false;
+
+                    for (auto& e : endpoints)
+                    {
+                        if (GeneratedCppClass::getEndpointHandleForName (e.endpointID.toString()) == handles[i]
+                             && ! e.isEvent())
+                        {
+                            result.push_back ({ handles[i], e.isStream() });
+                            found = true;
+                            break;
+                        }
+                    }
+
+                    if (! found)
+                        return false;
+                }
+
+                return true;
+            };
+
+            std::vector<Binding> newInputs, newOutputs;
+
+            if (! (findBindings (EndpointDetailsList::fromJSON (details["inputs"], true), inputs, numInputs, newInputs)
+                    && findBindings (EndpointDetailsList::fromJSON (details["outputs"], false), outputs, numOutputs, newOutputs)))
+                return Result::InvalidEndpointHandle;
+
+            inputBindings = std::move (newInputs);
+            outputBindings = std::move (newOutputs);
+            return Result::Ok;
+        }
+
+        Result processBlock (uint32_t numFrames, const void* const* inputData, void* const* outputData) override
+        {
+            if (numFrames == 0 || numFrames > GeneratedCppClass::maxFramesPerBlock)
+                return Result::InvalidBlockSize;
+
+            currentBlockSize = numFrames;
+
+            for (size_t i = 0; i < inputBindings.size(); ++i)
+            {
+                auto data = inputData[i];
+
+                if (inputBindings[i].isStream)
+                {
+                    if (data == nullptr)
+                        generatedObject.setInputFrames (inputBindings[i].handle, nullptr, 0, numFrames);
+                    else
+                        generatedObject.setInputFrames (inputBindings[i].handle, data, numFrames, 0);
+                }
+                else if (data != nullptr)
+                {
+                    generatedObject.setValue (inputBindings[i].handle, data, 0);
+                }
+            }
+
+            generatedObject.advance (static_cast<int32_t> (numFrames));
+
+            for (size_t i = 0; i < outputBindings.size(); ++i)
+            {
+                if (auto dest = outputData[i])
+                {
+                    if (outputBindings[i].isStream)
+                        generatedObject.copyOutputFrames (outputBindings[i].handle, dest, numFrames);
+                    else
+                        generatedObject.copyOutputValue (outputBindings[i].handle, dest);
+                }
+            }
+
+            return Result::Ok;
+        }
+
         const char* getStringForHandle (uint32_t handle, size_t& stringLength) override
         {
             return generatedObject.getStringForHandle (handle, stringLength);
@@ -224,8 +327,31 @@ private:
         uint32_t getMaximumBlockSize() override { return GeneratedCppClass::maxFramesPerBlock; }
         double getLatency() override            { return GeneratedCppClass::latency; }
         uint32_t getEventBufferSize() override  { return GeneratedCppClass::eventBufferSize; }
+        bool supportsFrameOffsets() override    { return false; }
+
+        // The generated class holds its state in ordinary C++ members, so there's no
+        // portable way to copy it as a block of raw data
+        uint64_t getStateSize() override                     { return 0; }
+        Result copyState (void*) override                    { return Result::InvalidState; }
+        Result setState (const void*, uint64_t) override     { return Result::InvalidState; }
+        const char* getStateLayout() override                { return nullptr; }
+
+        // The generated class keeps its stream buffers in private members
+        void* getStreamBuffer (EndpointHandle, uint32_t&) override   { return nullptr; }
+
+        EndpointHandle getEndpointHandleForInstance (EndpointHandle handle, uint32_t instanceIndex) override
+        {
+            return instanceIndex == 0 ? handle : EndpointHandle();
+        }
+
+        struct Binding
+        {
+            EndpointHandle handle;
+            bool isStream;
+        };
 
         GeneratedCppClass generatedObject;
+        std::vector<Binding> inputBindings, outputBindings;
         uint32_t currentBlockSize = 1;
         uint32_t xruns = 0;
         int32_t sessionID;
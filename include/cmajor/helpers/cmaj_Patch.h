@@ -130,6 +130,20 @@ struct Patch
     /// This defaults to false.
     void setAutoRebuildOnFileChange (bool shouldMonitorFilesForChanges);
 
+    /// Enables/disables tiered compilation. When enabled, a patch is first linked at a low
+    /// optimisation level so that it can start playing as soon as possible, and then a fully
+    /// optimised version is built on a background thread and swapped into the running patch,
+    /// keeping all of its current state.
+    /// This defaults to false.
+    void setTieredCompilation (bool shouldUseTieredCompilation);
+
+    /// Enables/disables carrying the running state across rebuilds of the same patch, e.g.
+    /// when its source files are edited. When enabled, the new build starts with the values of
+    /// any state variables whose names and types haven't changed, and its output is crossfaded
+    /// with the old version's output over the given number of frames.
+    /// This defaults to false.
+    void setStatePreservingReload (bool shouldPreserveState, uint32_t crossfadeFrames = 1024);
+
     /// Attempts to code-generate from a patch.
     Engine::CodeGenOutput generateCode (const LoadParams&,
                                         const std::string& targetType,
@@ -328,10 +342,14 @@ private:
     struct SourceTransformer;
     struct Build;
     struct BuildThread;
+    struct ReloadCrossfade;
     friend struct PatchView;
     friend struct PatchParameter;
 
     bool scanFilesForChanges = false;
+    bool useTieredCompilation = false;
+    bool preserveStateOnReload = false;
+    uint32_t reloadCrossfadeFrames = 0;
     LoadParams lastLoadParams;
     std::shared_ptr<PatchRenderer> renderer;
     PlaybackParams currentPlaybackParams;
@@ -354,8 +372,19 @@ private:
     std::unique_ptr<BuildThread> buildThread;
     std::atomic<uint16_t> nextViewID { 0 };
 
+    // The crossfade is owned by the message thread, and the audio thread clears the
+    // active pointer when it has finished with it
+    std::unique_ptr<ReloadCrossfade> reloadCrossfade;
+    std::atomic<ReloadCrossfade*> activeReloadCrossfade { nullptr };
+    choc::messageloop::Timer reloadCrossfadeTimer;
+
     void sendPatchChange();
     void setNewRenderer (std::shared_ptr<PatchRenderer>);
+    void setNewRendererFromBuild (Build&);
+    void startReloadCrossfade (std::shared_ptr<PatchRenderer> oldRenderer);
+    void clearReloadCrossfade();
+    ReloadCrossfade* getActiveReloadCrossfade (const choc::buffer::ChannelArrayView<float>& output);
+    void endReloadCrossfadeBlock (ReloadCrossfade*, const choc::buffer::ChannelArrayView<float>& output);
     void sendOutputEventToViews (uint64_t frame, std::string_view endpointID, const choc::value::ValueView&);
     PatchView* findViewForID (uint16_t) const;
     void startCheckingForChanges();
@@ -979,6 +1008,13 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
     }
 
     ~PatchRenderer()
+    {
+        stopCommunicatingWithPatch();
+    }
+
+    /// Stops the worker, infinite-loop checks and output events, for a renderer that's no
+    /// longer the active one but which is still being played while it fades out.
+    void stopCommunicatingWithPatch()
     {
         patchWorker.reset();
         infiniteLoopCheckTimer.clear();
@@ -1241,9 +1277,16 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
                                                 checkForStopSignal))
             return false;
 
-        engine.setBuildSettings (engine.getBuildSettings()
+        auto buildSettings = engine.getBuildSettings();
+        usesDynamicRate = buildSettings.shouldUseDynamicRate();
+
+        // With a dynamic rate, the block size in the settings is left as the upper bound
+        // that the host declared, so that the code doesn't depend on the current block size
+        if (! usesDynamicRate)
+            buildSettings.setMaxBlockSize (playbackParams.blockSize);
+
+        engine.setBuildSettings (buildSettings
                                    .setFrequency (playbackParams.sampleRate)
-                                   .setMaxBlockSize (playbackParams.blockSize)
                                    .setMainProcessor (manifest.mainProcessor));
 
         checkForStopSignal();
@@ -1557,6 +1600,56 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
                 param->gestureEnd();
     }
 
+    /// Swaps in the engine and performer from another renderer that was built from the
+    /// same patch (e.g. at a different optimisation level), carrying the current state
+    /// across so that playback continues seamlessly. The old engine and performer are
+    /// moved into the other renderer, so they'll be freed along with it.
+    /// The state is copied as a raw block, so this fails unless both performers have the
+    /// same state layout, e.g. if the sources were edited before the other one was built.
+    bool replacePerformerKeepingState (PatchRenderer& source)
+    {
+        if (performer == nullptr || source.performer == nullptr)
+            return false;
+
+        auto stateSize = source.performer->performer.getStateSize();
+
+        if (stateSize == 0 || stateSize != performer->performer.getStateSize())
+            return false;
+
+        auto sourceLayout = source.performer->performer.getStateLayout();
+        auto destLayout = performer->performer.getStateLayout();
+
+        if (! (sourceLayout.isObject() && destLayout.isObject())
+             || choc::json::toString (sourceLayout) != choc::json::toString (destLayout))
+            return false;
+
+        std::vector<uint8_t> state (static_cast<size_t> (stateSize));
+
+        {
+            std::scoped_lock lock (processLock);
+
+            if (performer->performer.copyState (state.data()) != Result::Ok
+                 || source.performer->performer.setState (state.data(), stateSize) != Result::Ok)
+                return false;
+
+            performer->swapPerformer (source.performer->performer);
+            std::swap (performer->engine, source.performer->engine);
+        }
+
+        lastBuildLog = source.lastBuildLog;
+        return true;
+    }
+
+    /// Copies any state variables whose names and types match from a renderer for an older
+    /// build of the same patch. Neither renderer must be playing when this is called.
+    bool copyMatchingStateFrom (PatchRenderer& source)
+    {
+        if (performer == nullptr || source.performer == nullptr)
+            return false;
+
+        return performer->performer.copyMatchingStateFrom (source.performer->performer) == Result::Ok;
+    }
+
     void resetToInitialState()
     {
         if (performer == nullptr)
@@ -1567,13 +1660,56 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
 
         {
             std::scoped_lock lock (processLock);
-            std::swap (performer->performer, newPerformer);
+            performer->swapPerformer (newPerformer);
         }
 
         for (auto& param : parameterList)
             param->resetToDefaultValue (true, -1, 0);
     }
 
+    /// If this renderer's code was built with a dynamic rate, this switches it to the new
+    /// playback settings by creating a new performer from the existing linked code, rather
+    /// than needing a rebuild. Block sizes don't matter, because the performer splits each
+    /// block into chunks that fit its maximum size. Returns false if a rebuild is needed.
+    bool applyPlaybackParams (const PlaybackParams& newParams)
+    {
+        if (newParams == configuredPlaybackParams)
+            return true;
+
+        if (performer == nullptr || ! usesDynamicRate
+             || newParams.numInputChannels != configuredPlaybackParams.numInputChannels
+             || newParams.numOutputChannels != configuredPlaybackParams.numOutputChannels)
+            return false;
+
+        if (newParams.sampleRate != sampleRate)
+        {
+            auto& engine = performer->engine;
+            engine.setBuildSettings (engine.getBuildSettings().setFrequency (newParams.sampleRate));
+
+            auto newPerformer = engine.createPerformer();
+
+            if (! newPerformer)
+                return false;
+
+            {
+                std::scoped_lock lock (processLock);
+                performer->swapPerformer (newPerformer);
+            }
+
+            sampleRate = newParams.sampleRate;
+
+            for (auto& l : endpointListeners.dataListeners)
+                if (l.second->customSource != nullptr)
+                    l.second->customSource->prepare (sampleRate);
+
+            for (auto& param : parameterList)
+                param->setValue (param->currentValue, true, 0, 0);
+        }
+
+        configuredPlaybackParams = newParams;
+        return true;
+    }
+
     void beginProcessBlock()    { processLock.lock(); }
     void endProcessBlock()      { processLock.unlock(); }
 
@@ -1681,6 +1817,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
     std::vector<PatchParameterPtr> parameterList;
     cmaj::EndpointDetailsList inputEndpoints, outputEndpoints;
     double sampleRate = 0;
+    bool usesDynamicRate = false;
     double framesLatency = 0;
     uint32_t numAudioInputChans = 0;
     uint32_t numAudioOutputChans = 0;
@@ -1819,6 +1956,16 @@ struct Patch::Build
          performLink (shouldLink)
     {}
 
+    /// Creates a build which will re-link an already-running renderer at a higher
+    /// optimisation level, so that its performer can be swapped for a faster one
+    Build (Patch& p, LoadParams lp, std::weak_ptr<PatchRenderer> target, int optimisationLevel)
+       : Build (p, std::move (lp), true, true)
+    {
+        rendererToUpgrade = std::move (target);
+        upgradeOptimisationLevel = optimisationLevel;
+        upgrading = true;
+    }
+
     cmaj::DiagnosticMessageList& getMessageList()
     {
         CMAJ_ASSERT (renderer != nullptr);
@@ -1831,6 +1978,23 @@ struct Patch::Build
         auto engine = patch.createEngine();
         CMAJ_ASSERT (engine);
 
+        if (isUpgrade())
+        {
+            engine.setBuildSettings (engine.getBuildSettings().setOptimisationLevel (upgradeOptimisationLevel));
+        }
+        else if (patch.useTieredCompilation && performLink)
+        {
+            auto level = engine.getBuildSettings().getOptimisationLevel();
+
+            // a negative level means "use the engine's default", which will be a high one
+            if (level < 0 || level > quickOptimisationLevel)
+            {
+                upgradeOptimisationLevel = level;
+                needsUpgrade = true;
+                engine.setBuildSettings (engine.getBuildSettings().setOptimisationLevel (quickOptimisationLevel));
+            }
+        }
+
         if (! loadParams.manifest.sourceTransformer.empty())
             sourceTransformer = std::make_unique<SourceTransformer> (patch, engine.getBuildSettings().getTransformTimeout());
 
@@ -1856,10 +2020,41 @@ struct Patch::Build
         return std::move (renderer);
     }
 
+    bool isUpgrade() const      { return upgrading; }
+
+    /// If this was a quick first-tier build, this returns a build that will produce
+    /// the fully-optimised version of the given renderer.
+    std::unique_ptr<Build> createUpgradeBuild (const std::shared_ptr<PatchRenderer>& target) const
+    {
+        if (! needsUpgrade || target == nullptr || ! target->isPlayable())
+            return {};
+
+        LoadParams params;
+        params.manifest = target->manifest;
+        return std::make_unique<Build> (patch, std::move (params), target, upgradeOptimisationLevel);
+    }
+
+    /// Called on the message thread when an upgrade build has finished, to swap
+    /// its performer into the target renderer, if that's still the active one.
+    void applyUpgrade()
+    {
+        auto target = rendererToUpgrade.lock();
+
+        if (target != nullptr && target == patch.renderer
+             && renderer != nullptr && renderer->isPlayable() && ! renderer->errors.hasErrors()
+             && renderer->applyPlaybackParams (target->configuredPlaybackParams))
+            target->replacePerformerKeepingState (*renderer);
+    }
+
+    static constexpr int quickOptimisationLevel = 1;
+
 private:
     Patch& patch;
     LoadParams loadParams;
     const bool resolveExternals, performLink;
+    std::weak_ptr<PatchRenderer> rendererToUpgrade;
+    int upgradeOptimisationLevel = -1;
+    bool needsUpgrade = false, upgrading = false;
     std::shared_ptr<PatchRenderer> renderer;
     std::unique_ptr<AudioMIDIPerformer::Builder> performerBuilder;
     std::unique_ptr<SourceTransformer> sourceTransformer;
@@ -1963,7 +2158,12 @@ private:
         }
 
         if (finishedTask && finishedTask->build)
-            owner.setNewRenderer (finishedTask->build->takeRenderer());
+        {
+            if (finishedTask->build->isUpgrade())
+                finishedTask->build->applyUpgrade();
+            else
+                owner.setNewRendererFromBuild (*finishedTask->build);
+        }
     }
 
     void clearTaskList()
@@ -1973,6 +2173,62 @@ private:
     }
 };
 
+//==============================================================================
+/// Keeps the renderer for the previous build of a patch playing for a short time after a
+/// rebuild, so that its output can be faded out while the new build's output fades in.
+struct Patch::ReloadCrossfade
+{
+    ReloadCrossfade (std::shared_ptr<PatchRenderer> r, const PlaybackParams& params, uint32_t numFrames)
+        : oldRenderer (std::move (r)),
+          oldOutput (params.numOutputChannels, params.blockSize),
+          totalFrames (numFrames)
+    {
+        oldRenderer->stopCommunicatingWithPatch();
+    }
+
+    bool isFinished() const     { return framesDone >= totalFrames; }
+
+    /// Returns a buffer into which the old version should render the block that's about to be
+    /// processed, or an empty view if it's bigger than the buffer that was allocated.
+    choc::buffer::ChannelArrayView<float> getOldOutput (const choc::buffer::ChannelArrayView<float>& output)
+    {
+        if (output.getNumChannels() > oldOutput.getNumChannels() || output.getNumFrames() > oldOutput.getNumFrames())
+            return {};
+
+        return oldOutput.getView().getChannelRange ({ 0, output.getNumChannels() })
+                                  .getFrameRange ({ 0, output.getNumFrames() });
+    }
+
+    /// Mixes the old version's output for this block into the new one's.
+    void mixInto (const choc::buffer::ChannelArrayView<float>& output)
+    {
+        auto numFrames = output.getNumFrames();
+
+        for (uint32_t frame = 0; frame < numFrames; ++frame)
+        {
+            auto newLevel = std::min (1.0f, static_cast<float> (framesDone + frame) / static_cast<float> (totalFrames));
+
+            for (uint32_t chan = 0; chan < output.getNumChannels(); ++chan)
+            {
+                auto& sample = output.getSample (chan, frame);
+                sample = sample * newLevel + oldOutput.getSample (chan, frame) * (1.0f - newLevel);
+            }
+        }
+
+        framesDone += numFrames;
+    }
+
+    /// Called if a block can't be crossfaded, to jump straight to the new version.
+    void finish()               { framesDone = totalFrames; }
+
+    std::shared_ptr<PatchRenderer> oldRenderer;
+    choc::buffer::ChannelArrayBuffer<float> oldOutput;
+    const uint32_t totalFrames;
+    uint32_t framesDone = 0;
+
+    const choc::audio::AudioMIDIBlockDispatcher::HandleMIDIMessageFn ignoreMIDIOutput = [] (uint32_t, choc::midi::ShortMessage) {};
+};
+
 //==============================================================================
 inline Patch::Patch()
 {
@@ -2024,7 +2280,7 @@ inline bool Patch::loadPatch (const LoadParams& params, bool synchronous)
     if (synchronous)
     {
         build->build ([] {});
-        setNewRenderer (build->takeRenderer());
+        setNewRendererFromBuild (*build);
         return isPlayable();
     }
 
@@ -2109,6 +2365,7 @@ inline void Patch::unload()
         if (stopPlayback)
             stopPlayback();
 
+        clearReloadCrossfade();
         renderer.reset();
         sendPatchChange();
         setStatus ({});
@@ -2129,6 +2386,17 @@ inline void Patch::setAutoRebuildOnFileChange (bool shouldMonitorFilesForChanges
         fileChangeChecker.reset();
 }
 
+inline void Patch::setTieredCompilation (bool shouldUseTieredCompilation)
+{
+    useTieredCompilation = shouldUseTieredCompilation;
+}
+
+inline void Patch::setStatePreservingReload (bool shouldPreserveState, uint32_t crossfadeFrames)
+{
+    preserveStateOnReload = shouldPreserveState;
+    reloadCrossfadeFrames = crossfadeFrames;
+}
+
 inline void Patch::startCheckingForChanges()
 {
     fileChangeChecker.reset();
@@ -2231,6 +2499,26 @@ inline void Patch::setPlaybackParams (PlaybackParams newParams, bool synchronous
     if (currentPlaybackParams != newParams)
     {
         currentPlaybackParams = newParams;
+
+        if (renderer != nullptr && renderer->isPlayable())
+        {
+            // As with a rebuild, playback is stopped while the performer, its data sources and
+            // the event queue are switched over, so the audio thread can't be using any of them
+            if (stopPlayback)
+                stopPlayback();
+
+            bool applied = renderer->applyPlaybackParams (newParams);
+
+            if (applied)
+                clientEventQueue->prepare (renderer->sampleRate);
+
+            if (startPlayback)
+                startPlayback();
+
+            if (applied)
+                return;
+        }
+
         rebuild (synchronousRebuild);
     }
 }
@@ -2355,10 +2643,23 @@ inline void Patch::process (float* const* audioChannels, uint32_t numFrames,
                             const choc::audio::AudioMIDIBlockDispatcher::HandleMIDIMessageFn& handleMIDIOut)
 {
     beginChunkedProcess();
-    renderer->getPerformer().processWithTimeStampedMIDI (choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numInputChannels, numFrames),
-                                                         choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numOutputChannels, numFrames),
+
+    auto input  = choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numInputChannels, numFrames);
+    auto output = choc::buffer::createChannelArrayView (audioChannels, currentPlaybackParams.numOutputChannels, numFrames);
+
+    // The input and output share the same channels, so the old version has to render first
+    auto fade = getActiveReloadCrossfade (output);
+
+    if (fade != nullptr)
+        fade->oldRenderer->getPerformer().processWithTimeStampedMIDI (input, fade->getOldOutput (output),
+                                                                      midiMessages.data(), midiMessageTimes.data(), static_cast<uint32_t> (midiMessages.size()),
+                                                                      fade->ignoreMIDIOutput, true);
+
+    renderer->getPerformer().processWithTimeStampedMIDI (input, output,
                                                          midiMessages.data(), midiMessageTimes.data(), static_cast<uint32_t> (midiMessages.size()),
                                                          handleMIDIOut, true);
+
+    endReloadCrossfadeBlock (fade, output);
     midiMessages.clear();
     midiMessageSpace.clear();
     midiMessageTimes.clear();
@@ -2372,6 +2673,66 @@ inline void Patch::process (const choc::audio::AudioMIDIBlockDispatcher::Block&
     endChunkedProcess();
 }
 
+inline Patch::ReloadCrossfade* Patch::getActiveReloadCrossfade (const choc::buffer::ChannelArrayView<float>& output)
+{
+    auto fade = activeReloadCrossfade.load();
+
+    if (fade == nullptr)
+        return {};
+
+    if (fade->getOldOutput (output).getNumFrames() != output.getNumFrames())
+        fade->finish();
+
+    if (fade->isFinished())
+    {
+        activeReloadCrossfade = nullptr;
+        return {};
+    }
+
+    return fade;
+}
+
+inline void Patch::endReloadCrossfadeBlock (ReloadCrossfade* fade, const choc::buffer::ChannelArrayView<float>& output)
+{
+    if (fade != nullptr)
+    {
+        if (! fade->isFinished())
+            fade->mixInto (output);
+
+        // After this, the audio thread won't touch the crossfade again, so the message thread can delete it
+        if (fade->isFinished())
+            activeReloadCrossfade = nullptr;
+    }
+}
+
+inline void Patch::startReloadCrossfade (std::shared_ptr<PatchRenderer> oldRenderer)
+{
+    clearReloadCrossfade();
+
+    if (reloadCrossfadeFrames == 0 || currentPlaybackParams.numOutputChannels == 0)
+        return;
+
+    reloadCrossfade = std::make_unique<ReloadCrossfade> (std::move (oldRenderer), currentPlaybackParams, reloadCrossfadeFrames);
+    activeReloadCrossfade = reloadCrossfade.get();
+
+    reloadCrossfadeTimer = choc::messageloop::Timer (100, [this]
+    {
+        if (activeReloadCrossfade != nullptr)
+            return true;
+
+        reloadCrossfade.reset();
+        return false;
+    });
+}
+
+/// This must only be called while playback is stopped
+inline void Patch::clearReloadCrossfade()
+{
+    reloadCrossfadeTimer.clear();
+    activeReloadCrossfade = nullptr;
+    reloadCrossfade.reset();
+}
+
 inline void Patch::beginChunkedProcess()
 {
     clientEventQueue->startOfProcessCallback();
@@ -2380,7 +2741,20 @@ inline void Patch::beginChunkedProcess()
 
 inline void Patch::processChunk (const choc::audio::AudioMIDIBlockDispatcher::Block& block, bool replaceOutput)
 {
+    auto fade = getActiveReloadCrossfade (block.audioOutput);
+
+    // When the output is being added to, the two versions can't be mixed, so the new one just takes over
+    if (fade != nullptr)
+    {
+        if (replaceOutput)
+            fade->oldRenderer->getPerformer().process ({ block.audioInput, fade->getOldOutput (block.audioOutput),
+                                                         block.midiMessages, fade->ignoreMIDIOutput }, true);
+        else
+            fade->finish();
+    }
+
     renderer->getPerformer().process (block, replaceOutput);
+    endReloadCrossfadeBlock (fade, block.audioOutput);
     clientEventQueue->postProcessChunk (block);
     renderer->processMIDIBlock (block);
 }
@@ -2587,18 +2961,28 @@ inline void Patch::setNewRenderer (std::shared_ptr<PatchRenderer> newRenderer)
     if (renderer == nullptr && newRenderer == nullptr)
         return;
 
-    if (currentPlaybackParams != newRenderer->configuredPlaybackParams)
+    if (! newRenderer->applyPlaybackParams (currentPlaybackParams))
         return;
 
     if (stopPlayback)
         stopPlayback();
 
     fileChangeChecker.reset();
-    renderer.reset();
+    clearReloadCrossfade();
+    auto oldRenderer = std::move (renderer);
     sendPatchChange();
 
     if (newRenderer != nullptr)
     {
+        if (preserveStateOnReload && oldRenderer != nullptr
+             && oldRenderer->isPlayable() && newRenderer->isPlayable()
+             && oldRenderer->manifest.manifestFile == newRenderer->manifest.manifestFile)
+        {
+            newRenderer->copyMatchingStateFrom (*oldRenderer);
+            startReloadCrossfade (std::move (oldRenderer));
+        }
+
+        oldRenderer.reset();
         renderer = std::move (newRenderer);
         sendPatchChange();
 
@@ -2631,6 +3015,23 @@ inline void Patch::setNewRenderer (std::shared_ptr<PatchRenderer> newRenderer)
     startCheckingForChanges();
 }
 
+inline void Patch::setNewRendererFromBuild (Build& build)
+{
+    auto newRenderer = build.takeRenderer();
+    setNewRenderer (newRenderer);
+
+    if (renderer == newRenderer)
+    {
+        if (auto upgrade = build.createUpgradeBuild (newRenderer))
+        {
+            if (buildThread == nullptr)
+                buildThread = std::make_unique<BuildThread> (*this);
+
+            buildThread->startBuild (std::move (upgrade));
+        }
+    }
+}
+
 inline void Patch::addActiveView (PatchView& v)
 {
     activeViews.push_back (std::addressof (v));
@@ -35,16 +35,31 @@ struct PerformerProxy  : public PerformerInterface
     Result setInputFrames (EndpointHandle e, const void* data, uint32_t numFrames) override         { return target->setInputFrames (e, data, numFrames); }
     Result setInputValue (EndpointHandle e, const void* data, uint32_t n) override                  { return target->setInputValue (e, data, n); }
     Result addInputEvent (EndpointHandle e, uint32_t index, const void* data) override              { return target->addInputEvent (e, index, data); }
+    Result addInputEventAtFrame (EndpointHandle e, uint32_t i, const void* d, uint32_t f) override  { return target->addInputEventAtFrame (e, i, d, f); }
     Result copyOutputValue (EndpointHandle e, void* dest) override                                  { return target->copyOutputValue (e, dest); }
     Result copyOutputFrames (EndpointHandle e, void* dest, uint32_t num) override                   { return target->copyOutputFrames (e, dest, num); }
     Result iterateOutputEvents (EndpointHandle e, void* c, HandleOutputEventCallback h) override    { return target->iterateOutputEvents (e, c, h); }
     Result advance() override                                                                       { return target->advance(); }
+    Result processBlock (uint32_t n, const void* const* in, void* const* out) override             { return target->processBlock (n, in, out); }
+
+    Result setBlockBindings (const EndpointHandle* inputs, uint32_t numInputs, const EndpointHandle* outputs, uint32_t numOutputs) override
+    {
+        return target->setBlockBindings (inputs, numInputs, outputs, numOutputs);
+    }
+
     const char* getStringForHandle (uint32_t h, size_t& len) override                               { return target->getStringForHandle (h, len); }
     uint32_t getXRuns() override                                                                    { return target->getXRuns(); }
     uint32_t getMaximumBlockSize() override                                                         { return target->getMaximumBlockSize(); }
     double getLatency() override                                                                    { return target->getLatency(); }
     uint32_t getEventBufferSize() override                                                          { return target->getEventBufferSize(); }
+    bool supportsFrameOffsets() override                                                            { return target->supportsFrameOffsets(); }
     const char* getRuntimeError() override                                                          { return target->getRuntimeError(); }
+    void* getStreamBuffer (EndpointHandle e, uint32_t& frameStride) override                        { return target->getStreamBuffer (e, frameStride); }
+    EndpointHandle getEndpointHandleForInstance (EndpointHandle e, uint32_t instance) override      { return target->getEndpointHandleForInstance (e, instance); }
+    uint64_t getStateSize() override                                                                { return target->getStateSize(); }
+    Result copyState (void* dest) override                                                          { return target->copyState (dest); }
+    Result setState (const void* source, uint64_t size) override                                    { return target->setState (source, size); }
+    const char* getStateLayout() override                                                           { return target->getStateLayout(); }
 
     PerformerPtr target;
 };
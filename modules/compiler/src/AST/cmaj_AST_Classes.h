@@ -183,6 +183,7 @@ struct Function  : public Object
     bool isMainFunction() const                     { return name == getStrings().mainFunctionName; }
     bool isSystemInitFunction() const               { return name == getStrings().systemInitFunctionName; }
     bool isSystemAdvanceFunction() const            { return name == getStrings().systemAdvanceFunctionName; }
+    bool isSystemAdvanceToFrameFunction() const     { return name == getStrings().advanceToFrameFunctionName; }
     bool isUserInitFunction() const                 { return name == getStrings().userInitFunctionName; }
     bool isResetFunction() const                    { return name == getStrings().resetFunctionName && getNumNonInternalParameters() == 0; }
     bool isExportedFunction() const                 { return isExported || isEventHandler || isSystemInitFunction() || isSystemAdvanceFunction() || isMainFunction() || isUserInitFunction(); }
@@ -62,6 +62,30 @@ struct ExternalVariableManager
         return false;
     }
 
+    /// Adds the names and values of all the externals to a hash, so that a cache key
+    /// can take into account the values that get baked into the compiled code
+    template <typename Hash>
+    void addToHash (Hash& hash) const
+    {
+        std::vector<std::string_view> names;
+
+        for (auto& e : externals)
+            names.push_back (e.first);
+
+        std::sort (names.begin(), names.end());
+
+        for (auto& name : names)
+        {
+            hash.addInput (name);
+
+            if (auto& value = externals.find (std::string (name))->second)
+            {
+                auto serialised = value->serialise();
+                hash.addInput (serialised.data.data(), serialised.data.size());
+            }
+        }
+    }
+
 private:
     std::unordered_map<std::string, std::optional<choc::value::Value>> externals;
 
@@ -353,17 +377,10 @@ struct ExternalFunctionManager
         auto& fn = functionPointers[std::addressof (f)];
 
         if (requestExternalFunction != nullptr)
-        {
-            auto paramTypes = choc::value::createEmptyArray();
-
-            for (auto& p : f.getParameterTypes())
-                paramTypes.addArrayElement (p->toChocType().toValue());
-
             if (auto resolved = requestExternalFunction (context,
                                                          f.getFullyQualifiedReadableName().c_str(),
-                                                         choc::json::toString (paramTypes, false).c_str()))
+                                                         getParameterTypesJSON (f).c_str()))
                 fn = resolved;
-        }
     }
 
     void addFunctionWithImplementation (const Function& f, void* nativeFunction)
@@ -381,6 +398,28 @@ struct ExternalFunctionManager
         return {};
     }
 
+    /// Finds a resolved function by the name and parameter types that were passed to the
+    /// external requestor, which stay the same when a program is rebuilt from the same source.
+    void* findResolvedFunction (std::string_view fullyQualifiedName, std::string_view parameterTypesJSON) const
+    {
+        for (auto& fn : functionPointers)
+            if (fn.first->getFullyQualifiedReadableName() == fullyQualifiedName
+                 && getParameterTypesJSON (*fn.first) == parameterTypesJSON)
+                return fn.second;
+
+        return {};
+    }
+
+    static std::string getParameterTypesJSON (const Function& f)
+    {
+        auto paramTypes = choc::value::createEmptyArray();
+
+        for (auto& p : f.getParameterTypes())
+            paramTypes.addArrayElement (p->toChocType().toValue());
+
+        return choc::json::toString (paramTypes, false);
+    }
+
 private:
     std::unordered_map<const Function*, void*> functionPointers;
     EngineInterface::RequestExternalFunctionFn requestExternalFunction = nullptr;
@@ -96,6 +96,7 @@ struct Strings
                        resetFunctionName             { stringPool.get ("reset") },
                        systemInitFunctionName        { stringPool.get ("_initialise") },
                        systemAdvanceFunctionName     { stringPool.get ("_advance") },
+                       advanceToFrameFunctionName    { stringPool.get ("_advanceToFrame") },
                        rootNamespaceName             { stringPool.get ("_root") },
                        initFnProcessorIDParamName    { stringPool.get ("processorID") },
                        initFnSessionIDParamName      { stringPool.get ("sessionID") },
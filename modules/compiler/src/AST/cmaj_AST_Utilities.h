@@ -948,10 +948,12 @@ struct EndpointList
         outputEndpointDetails.endpoints.clear();
     }
 
-    void initialise (const AST::ProcessorBase& processor)
+    void initialise (const AST::ProcessorBase& processor,
+                     const std::function<bool(const EndpointID&)>& isEndpointFrozen = {})
     {
         for (auto& e : processor.endpoints.iterateAs<AST::EndpointDeclaration>())
-            endpoints.push_back ({ e, createEndpointDetails (e) });
+            if (! (isEndpointFrozen && isEndpointFrozen (e.getEndpointID())))
+                endpoints.push_back ({ e, createEndpointDetails (e) });
 
         inputEndpointDetails = getEndpointDetails (true);
         outputEndpointDetails = getEndpointDetails (false);
@@ -24,9 +24,309 @@
 #include "cmaj_Parser.h"
 #include "../standard_library/cmaj_StandardLibrary.h"
 #include "../standard_library/cmaj_StandardLibraryBinary.h"
+#include <mutex>
+#include <set>
 
 namespace cmaj
 {
+    //==============================================================================
+    /// Keeps the parsed form of recently-seen source files as binary modules, keyed on a
+    /// hash of their name and content. When a program is rebuilt after an edit, any files
+    /// that haven't changed can then be re-created from this rather than lexed and parsed
+    /// again. This is shared between all programs, because a host will usually create a
+    /// new Program object for each rebuild.
+    struct ParsedSourceCache
+    {
+        static ParsedSourceCache& getInstance()
+        {
+            static ParsedSourceCache cache;
+            return cache;
+        }
+
+        static uint64_t getKey (const SourceFile& source, bool isSystemModule, bool parseComments)
+        {
+            choc::hash::xxHash64 hash;
+            hash.addInput (source.filename);
+            hash.addInput (std::string_view ("\0", 1));
+            hash.addInput (source.content);
+            char flags[] = { isSystemModule ? '1' : '0', parseComments ? '1' : '0' };
+            hash.addInput (flags, sizeof (flags));
+            return hash.getHash();
+        }
+
+        using ModuleData = std::shared_ptr<const std::vector<uint8_t>>;
+
+        ModuleData find (uint64_t key)
+        {
+            std::lock_guard<decltype(lock)> l (lock);
+
+            for (auto i = entries.begin(); i != entries.end(); ++i)
+            {
+                if (i->key == key)
+                {
+                    auto entry = *i;
+                    entries.erase (i);
+                    entries.push_back (entry);
+                    return entry.data;
+                }
+            }
+
+            return {};
+        }
+
+        void store (uint64_t key, std::vector<uint8_t>&& data)
+        {
+            std::lock_guard<decltype(lock)> l (lock);
+
+            totalSize += data.size();
+            entries.push_back ({ key, std::make_shared<const std::vector<uint8_t>> (std::move (data)) });
+
+            while (totalSize > maxTotalSize && entries.size() > 1)
+            {
+                totalSize -= entries.front().data->size();
+                entries.erase (entries.begin());
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t key;
+            ModuleData data;
+        };
+
+        std::mutex lock;
+        std::vector<Entry> entries; // least recently used first
+        size_t totalSize = 0;
+        static constexpr size_t maxTotalSize = 32 * 1024 * 1024;
+    };
+
+    //==============================================================================
+    /// Gives each program a copy of the standard library that only contains the parts its
+    /// code could use.
+    ///
+    /// The units which can be left out are the namespaces directly inside std. Once per
+    /// process, the library is loaded and each unit's dependencies are found, from both its
+    /// resolved references and any identifiers that match another unit's name. A program then
+    /// gets every unit whose name appears anywhere in its source files, plus std::intrinsics
+    /// and anything that std itself uses, and all of their dependencies. Because code can
+    /// only get at a std namespace by naming it, this errs on the side of including too much.
+    /// Each distinct subset is written as a binary module once, and then shared by all the
+    /// programs that need it.
+    struct StandardLibraryImages
+    {
+        static StandardLibraryImages& getInstance()
+        {
+            static StandardLibraryImages images;
+            return images;
+        }
+
+        using ModuleData = std::shared_ptr<const std::vector<uint8_t>>;
+
+        /// Returns the data to load for a program with these source files, or nullptr if
+        /// it needs the whole library.
+        ModuleData getImageFor (const SourceFileList& sources)
+        {
+            if (units.empty())
+                return {};
+
+            std::vector<bool> included (units.size(), false);
+            std::vector<size_t> unitsToAdd;
+
+            for (size_t i = 0; i < units.size(); ++i)
+            {
+                if (units[i].alwaysNeeded)
+                {
+                    unitsToAdd.push_back (i);
+                    continue;
+                }
+
+                for (auto& source : sources.sourceFiles)
+                {
+                    if (source->content.find (units[i].name) != std::string::npos)
+                    {
+                        unitsToAdd.push_back (i);
+                        break;
+                    }
+                }
+            }
+
+            while (! unitsToAdd.empty())
+            {
+                auto i = unitsToAdd.back();
+                unitsToAdd.pop_back();
+
+                if (! included[i])
+                {
+                    included[i] = true;
+                    unitsToAdd.insert (unitsToAdd.end(), units[i].dependencies.begin(), units[i].dependencies.end());
+                }
+            }
+
+            if (std::find (included.begin(), included.end(), false) == included.end())
+                return {};
+
+            std::lock_guard<decltype(lock)> l (lock);
+
+            for (auto& image : images)
+                if (image.included == included)
+                    return image.data;
+
+            auto data = std::make_shared<const std::vector<uint8_t>> (createImage (included));
+            images.push_back ({ std::move (included), data });
+
+            if (images.size() > maxNumImages)
+                images.erase (images.begin());
+
+            return data;
+        }
+
+    private:
+        struct Unit
+        {
+            std::string name;
+            std::vector<size_t> dependencies;
+            bool alwaysNeeded = false;
+        };
+
+        struct Image
+        {
+            std::vector<bool> included;
+            ModuleData data;
+        };
+
+        std::vector<Unit> units;
+        std::mutex lock;
+        std::vector<Image> images;
+        static constexpr size_t maxNumImages = 32;
+
+        StandardLibraryImages()
+        {
+            try
+            {
+                findUnits();
+            }
+            catch (...)
+            {
+                units.clear();
+            }
+        }
+
+        static ptr<AST::Namespace> loadLibrary (AST::Program& program)
+        {
+            for (auto& m : transformations::parseBinaryModule (program.allocator, standardLibraryData, sizeof (standardLibraryData), false))
+                program.rootNamespace.subModules.addChildObject (m);
+
+            transformations::mergeDuplicateNamespaces (program.rootNamespace);
+            return program.rootNamespace.findSystemChildNamespace (program.allocator.strings.stdLibraryNamespaceName);
+        }
+
+        struct DependencyFinder
+        {
+            const std::unordered_map<std::string_view, size_t>& unitNames;
+            const std::unordered_map<const AST::Object*, size_t>& unitModules;
+            std::set<size_t> found;
+
+            void addObject (AST::Object& o)
+            {
+                for (auto p : o.getPropertyList())
+                    addProperty (*p);
+            }
+
+            void addProperty (AST::Property& p)
+            {
+                if (auto s = p.getAsStringProperty())
+                {
+                    if (auto unit = unitNames.find (s->get().get()); unit != unitNames.end())
+                        found.insert (unit->second);
+                }
+                else if (auto list = p.getAsListProperty())
+                {
+                    for (auto& item : *list)
+                        addProperty (item.get());
+                }
+                else if (auto objectProperty = p.getAsObjectProperty())
+                {
+                    if (auto target = objectProperty->getRawPointer())
+                    {
+                        if (! objectProperty->isParentOfObject())
+                            addUnitContaining (*target);
+                        else if (unitModules.find (target) == unitModules.end())
+                            addObject (*target);
+                    }
+                }
+            }
+
+            void addUnitContaining (const AST::Object& o)
+            {
+                for (auto p = std::addressof (o); p != nullptr; p = p->getParentScope().get())
+                {
+                    if (auto unit = unitModules.find (p); unit != unitModules.end())
+                    {
+                        found.insert (unit->second);
+                        return;
+                    }
+                }
+            }
+        };
+
+        void findUnits()
+        {
+            AST::Program program;
+            auto stdNamespace = loadLibrary (program);
+
+            if (stdNamespace == nullptr)
+                return;
+
+            std::unordered_map<std::string_view, size_t> unitNames;
+            std::unordered_map<const AST::Object*, size_t> unitModules;
+            auto modules = stdNamespace->getSubModules();
+
+            for (auto& m : modules)
+            {
+                auto name = m->getName().get();
+                unitNames[name] = units.size();
+                unitModules[m.getPointer()] = units.size();
+                units.push_back ({ std::string (name), {}, name == getIntrinsicsNamespaceName() });
+            }
+
+            for (size_t i = 0; i < units.size(); ++i)
+            {
+                DependencyFinder finder { unitNames, unitModules, {} };
+                finder.addObject (modules[i].get());
+                finder.found.erase (i);
+                units[i].dependencies.assign (finder.found.begin(), finder.found.end());
+            }
+
+            DependencyFinder finder { unitNames, unitModules, {} };
+            finder.addObject (*stdNamespace);
+
+            for (auto i : finder.found)
+                units[i].alwaysNeeded = true;
+        }
+
+        std::vector<uint8_t> createImage (const std::vector<bool>& included) const
+        {
+            AST::Program program;
+            auto stdNamespace = loadLibrary (program);
+            CMAJ_ASSERT (stdNamespace != nullptr);
+
+            for (auto& m : stdNamespace->getSubModules())
+            {
+                for (size_t i = 0; i < units.size(); ++i)
+                {
+                    if (! included[i] && m->getName().get() == units[i].name)
+                    {
+                        stdNamespace->subModules.removeObject (m.get());
+                        break;
+                    }
+                }
+            }
+
+            return transformations::createBinaryModule (program.getTopLevelModules());
+        }
+    };
+
     const char* Library::getVersion()
     {
         // This needs to be set to something sensible
@@ -41,13 +341,71 @@ namespace cmaj
 
     void AST::Program::parse (const SourceFile& source, bool isSystemModule)
     {
-        Parser::parseModuleDeclarations (allocator, source, isSystemModule, parsingComments, rootNamespace, {});
         resetMainProcessor();
+
+        if (transformations::isValidBinaryModuleData (source.content.data(), source.content.size()))
+        {
+            Parser::parseModuleDeclarations (allocator, source, isSystemModule, parsingComments, rootNamespace, {});
+            return;
+        }
+
+        auto& cache = ParsedSourceCache::getInstance();
+        auto cacheKey = ParsedSourceCache::getKey (source, isSystemModule, parsingComments);
+
+        if (auto cached = cache.find (cacheKey))
+        {
+            auto modules = transformations::parseBinaryModule (allocator, cached->data(), cached->size(), false, std::addressof (source));
+
+            if (! modules.empty())
+            {
+                for (auto& m : modules)
+                    rootNamespace.subModules.addChildObject (m);
+
+                transformations::mergeDuplicateNamespaces (rootNamespace);
+                return;
+            }
+        }
+
+        // The file is parsed into a temporary namespace so that its modules can be stored
+        // before they get merged with those from other files
+        auto& fileNamespace = allocator.createNamespace (allocator.strings.rootNamespaceName);
+        fileNamespace.isSystem = true;
+
+        auto moveToRootNamespace = [&]
+        {
+            for (auto& m : fileNamespace.getSubModules())
+                rootNamespace.subModules.addChildObject (m);
+
+            for (auto& a : fileNamespace.aliases.iterateAs<AST::Alias>())
+                rootNamespace.aliases.addChildObject (a);
+
+            transformations::mergeDuplicateNamespaces (rootNamespace);
+        };
+
+        try
+        {
+            Parser::parseModuleDeclarations (allocator, source, isSystemModule, parsingComments, fileNamespace, {});
+        }
+        catch (...)
+        {
+            moveToRootNamespace();
+            throw;
+        }
+
+        if (fileNamespace.aliases.empty())
+            cache.store (cacheKey, transformations::createBinaryModule (fileNamespace.getSubModules(), std::addressof (source)));
+
+        moveToRootNamespace();
     }
 
     void AST::Program::addStandardLibraryCode()
     {
-        for (auto& m : transformations::parseBinaryModule (allocator, standardLibraryData, sizeof (standardLibraryData), false))
+        auto image = StandardLibraryImages::getInstance().getImageFor (allocator.sourceFileList);
+
+        auto modules = image != nullptr ? transformations::parseBinaryModule (allocator, image->data(), image->size(), false)
+                                        : transformations::parseBinaryModule (allocator, standardLibraryData, sizeof (standardLibraryData), false);
+
+        for (auto& m : modules)
             rootNamespace.subModules.addChildObject (m);
 
         transformations::mergeDuplicateNamespaces (rootNamespace);
@@ -810,12 +810,13 @@ IO_STRUCT io = {};
 
                     if (maxNumFramesPerBlock == 1)
                     {
-                        out << "(void) numTrailingFramesToClear;" << newLine
-                            << "memcpy (&" << buffer << ", data, " << frameStride << ");" << newLine;
+                        out << "(void) numFrames; (void) numTrailingFramesToClear;" << newLine
+                            << "if (data != nullptr) memcpy (&" << buffer << ", data, " << frameStride << ");" << newLine
+                            << "else memset (&" << buffer << ", 0, " << frameStride << ");" << newLine;
                     }
                     else
                     {
-                        out << "memcpy (" << buffer << ".elements, data, numFrames * " << frameStride << ");" << newLine
+                        out << "if (numFrames != 0) memcpy (" << buffer << ".elements, data, numFrames * " << frameStride << ");" << newLine
                             << "if (numTrailingFramesToClear != 0) memset (" << buffer << ".elements + numFrames, 0, numTrailingFramesToClear * " << frameStride << ");" << newLine;
                     }
 
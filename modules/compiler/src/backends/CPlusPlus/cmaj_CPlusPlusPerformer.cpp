@@ -153,6 +153,7 @@ struct CPlusPlusEngine
     static constexpr bool usesDynamicRateAndSessionID = true;
     static constexpr bool allowTopLevelSlices = false;
     static constexpr bool supportsExternalFunctions = false;
+    static constexpr bool canLinkFromCachedCode = false;
     static bool engineSupportsIntrinsic (AST::Intrinsic::Type) { return true; }
 
     //==============================================================================
@@ -248,9 +249,9 @@ extern "C" CMAJ_DLL_EXPORT cmaj::EngineInterface* createEngine()
     // This is just needed to manage the COM object lifetimes
     struct Proxy  : public choc::com::ObjectWithAtomicRefCount<cmaj::PerformerProxy, Proxy>
     {
-        Proxy (std::shared_ptr<LinkedCode> c, cmaj::EnginePtr e)  : engine (e), code (c)
+        Proxy (std::shared_ptr<LinkedCode> c, cmaj::EnginePtr e, PerformerInterface* p)  : engine (e), code (c)
         {
-            target = PerformerPtr (e->createPerformer());
+            target = PerformerPtr (p);
         }
 
         ~Proxy()
@@ -263,12 +264,16 @@ extern "C" CMAJ_DLL_EXPORT cmaj::EngineInterface* createEngine()
         std::shared_ptr<LinkedCode> code;
     };
 
-    PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code)
+    PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code, uint32_t numInstances)
     {
         cmaj::Engine e;
         e.engine = EnginePtr (code->createEngineFn());
         e.setBuildSettings (code->buildSettings);
-        return choc::com::create<Proxy> (code, e.engine).getWithIncrementedRefCount();
+
+        if (auto p = e.engine->createMultiInstancePerformer (numInstances))
+            return choc::com::create<Proxy> (code, e.engine, p).getWithIncrementedRefCount();
+
+        return {};
     }
 };
 
@@ -21,6 +21,7 @@
 #include "choc/memory/choc_Endianness.h"
 #include "../../codegen/cmaj_CodeGenHelpers.h"
 #include "../../validation/cmaj_ValidationUtilities.h"
+#include "cmaj_LLVMVectorMaths.h"
 
 namespace cmaj::llvm
 {
@@ -50,6 +51,7 @@ struct LLVMCodeGenerator
         targetModule->setTargetTriple (targetTriple);
 
         useFastMaths = buildSettings.shouldUseFastMaths();
+        mathsAccuracy = buildSettings.getMathsAccuracy();
 
         auto& mainProcessor = program.getMainProcessor();
 
@@ -94,6 +96,11 @@ struct LLVMCodeGenerator
         }
        #endif
 
+        if (buildSettings.shouldInstrumentForProfiling())
+            addProfilingInstrumentation();
+        else if (profileData.isObject())
+            applyProfileData (profileData);
+
         dumpDebugPrintout ("Pre optimisation", false);
         applyOptimisationPasses();
         dumpDebugPrintout ("Post optimisation");
@@ -117,45 +124,153 @@ struct LLVMCodeGenerator
     }
 
     bool reloadDictionary (choc::span<char>& bitcode)
+    {
+        return readDictionary (stringDictionary, bitcode);
+    }
+
+    static bool readDictionary (choc::value::SimpleStringDictionary& dictionary, choc::span<char>& data)
     {
         size_t totalDictionarySize = sizeof (uint32_t);
 
-        if (bitcode.size() < totalDictionarySize)
+        if (data.size() < totalDictionarySize)
             return false;
 
-        if (auto dictionaryDataSize = choc::memory::readLittleEndian<uint32_t> (bitcode.data()))
+        if (auto dictionaryDataSize = choc::memory::readLittleEndian<uint32_t> (data.data()))
         {
             totalDictionarySize += dictionaryDataSize;
 
-            if (bitcode.size() < totalDictionarySize)
+            if (data.size() < totalDictionarySize)
                 return false;
 
-            stringDictionary.strings.resize (dictionaryDataSize);
-            memcpy (stringDictionary.strings.data(), bitcode.data() + sizeof (uint32_t), dictionaryDataSize);
+            dictionary.strings.resize (dictionaryDataSize);
+            memcpy (dictionary.strings.data(), data.data() + sizeof (uint32_t), dictionaryDataSize);
         }
 
-        bitcode = { bitcode.begin() + totalDictionarySize, bitcode.end() };
+        data = { data.begin() + totalDictionarySize, data.end() };
         return true;
     }
 
+    void writeDictionary (::llvm::raw_ostream& s)
+    {
+        char dictionarySize[sizeof (uint32_t)];
+        choc::memory::writeLittleEndian (dictionarySize, static_cast<uint32_t> (stringDictionary.strings.size()));
+        s.write (dictionarySize, sizeof (dictionarySize));
+        s.write (stringDictionary.strings.data(), stringDictionary.strings.size());
+    }
+
     void saveBitcodeToCache (CacheDatabaseInterface& cache, const char* key)
     {
         ::llvm::SmallVector<char, 64> bitcode;
 
         {
             ::llvm::raw_svector_ostream s (bitcode);
-
-            char dictionarySize[sizeof (uint32_t)];
-            choc::memory::writeLittleEndian (dictionarySize, static_cast<uint32_t> (stringDictionary.strings.size()));
-            s.write (dictionarySize, sizeof (dictionarySize));
-            s.write (stringDictionary.strings.data(), stringDictionary.strings.size());
-
+            writeDictionary (s);
             ::llvm::WriteBitcodeToFile (*targetModule, s);
         }
 
         cache.store (key, bitcode.data(), bitcode.size());
     }
 
+    /// Runs the machine code generation for the (already optimised) module, returning
+    /// a relocatable object file that can be handed straight to the JIT's object layer
+    std::unique_ptr<::llvm::MemoryBuffer> compileToObjectCode (::llvm::TargetMachine& targetMachine)
+    {
+        CMAJ_ASSERT (targetModule != nullptr);
+
+        if (shouldPartitionModule())
+            runOptimisationPasses (*targetModule, getOptimisationLevelWithDefault (buildSettings.getOptimisationLevel()),
+                                   PipelineStage::postLink, std::addressof (targetMachine));
+
+        ::llvm::orc::SimpleCompiler compiler (targetMachine);
+
+        if (auto objectCode = compiler (*targetModule))
+            return std::move (*objectCode);
+        else
+            throwError (Errors::failedToJit (toString (objectCode.takeError())));
+
+        return {};
+    }
+
+    /// Splits the module into partitions, then finishes optimising each one and generates its
+    /// machine code on a separate thread, with its own LLVMContext and TargetMachine. The
+    /// whole-program inlining will already have been done by generate() before the split, so
+    /// the partitions only lose the (much cheaper) cross-function optimisations between them.
+    template <typename CreateTargetMachine>
+    std::vector<std::unique_ptr<::llvm::MemoryBuffer>> compilePartitionsToObjectCode (CreateTargetMachine&& createTargetMachine)
+    {
+        CMAJ_ASSERT (targetModule != nullptr && shouldPartitionModule());
+
+        std::vector<::llvm::SmallVector<char, 0>> partitions;
+
+        ::llvm::SplitModule (*targetModule, buildSettings.getCodeGenThreads(), [&] (std::unique_ptr<::llvm::Module> partition)
+        {
+            ::llvm::raw_svector_ostream s (partitions.emplace_back());
+            ::llvm::WriteBitcodeToFile (*partition, s);
+        });
+
+        auto optLevel = getOptimisationLevelWithDefault (buildSettings.getOptimisationLevel());
+        std::vector<std::unique_ptr<::llvm::MemoryBuffer>> objectFiles (partitions.size());
+        std::vector<std::string> errors (partitions.size());
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < partitions.size(); ++i)
+        {
+            threads.emplace_back ([&partitions, &objectFiles, &errors, optLevel, i,
+                                   targetMachine = createTargetMachine()]
+            {
+                ::llvm::LLVMContext partitionContext;
+                auto buffer = ::llvm::MemoryBuffer::getMemBuffer ({ partitions[i].data(), partitions[i].size() }, {}, false);
+                auto module = ::llvm::parseBitcodeFile (buffer->getMemBufferRef(), partitionContext);
+
+                if (! module)
+                {
+                    errors[i] = toString (module.takeError());
+                    return;
+                }
+
+                runOptimisationPasses (**module, optLevel, PipelineStage::postLink, targetMachine.get());
+
+                ::llvm::orc::SimpleCompiler compiler (*targetMachine);
+
+                if (auto objectCode = compiler (**module))
+                    objectFiles[i] = std::move (*objectCode);
+                else
+                    errors[i] = toString (objectCode.takeError());
+            });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        for (auto& error : errors)
+            if (! error.empty())
+                throwError (Errors::failedToJit (error));
+
+        return objectFiles;
+    }
+
+    /// Stores the dictionary, an opaque block of link information supplied by the caller,
+    /// and the object code, in a single cache entry
+    void saveObjectCodeToCache (CacheDatabaseInterface& cache, const char* key, const ::llvm::MemoryBuffer& objectCode,
+                                choc::span<const uint8_t> linkInfo)
+    {
+        ::llvm::SmallVector<char, 64> data;
+
+        {
+            ::llvm::raw_svector_ostream s (data);
+            writeDictionary (s);
+
+            char linkInfoSize[sizeof (uint32_t)];
+            choc::memory::writeLittleEndian (linkInfoSize, static_cast<uint32_t> (linkInfo.size()));
+            s.write (linkInfoSize, sizeof (linkInfoSize));
+            s.write (reinterpret_cast<const char*> (linkInfo.data()), linkInfo.size());
+
+            s.write (objectCode.getBufferStart(), objectCode.getBufferSize());
+        }
+
+        cache.store (key, data.data(), data.size());
+    }
+
     void dumpDebugPrintout (const char* description, bool includeAssembly = true)
     {
         if (buildSettings.shouldDumpDebugInfo())
@@ -171,6 +286,56 @@ struct LLVMCodeGenerator
         }
     }
 
+    void addStateLayoutEntries (choc::value::Value& variables, const AST::StructType& type,
+                                const std::string& parentName, size_t parentOffset, bool isInternal)
+    {
+        for (uint32_t i = 0; i < type.memberNames.size(); ++i)
+        {
+            auto memberName = std::string (type.getMemberName (i));
+            auto name = parentName.empty() ? memberName : parentName + "." + memberName;
+            auto offset = parentOffset + getStructMemberOffset (type, i);
+            addStateLayoutEntries (variables, type.getMemberType (i).skipConstAndRefModifiers(), name, offset,
+                                   isInternal || memberName.front() == '_');
+        }
+    }
+
+    void addStateLayoutEntries (choc::value::Value& variables, const AST::TypeBase& type,
+                                const std::string& name, size_t offset, bool isInternal)
+    {
+        // Structs are broken down into their members, so that a variable that's been added
+        // to a processor doesn't stop the rest of its state being matched
+        if (auto s = type.getAsStructType())
+            return addStateLayoutEntries (variables, *s, name, offset, isInternal);
+
+        if (type.isFixedSizeArray())
+        {
+            auto& elementType = type.getArrayOrVectorElementType()->skipConstAndRefModifiers();
+            auto numElements = type.getFixedSizeAggregateNumElements();
+
+            if (elementType.isStruct() && numElements <= maxStateLayoutArrayElements)
+            {
+                auto stride = getPaddedTypeSize (elementType);
+
+                for (uint32_t i = 0; i < numElements; ++i)
+                    addStateLayoutEntries (variables, elementType, name + "[" + std::to_string (i) + "]",
+                                           offset + i * stride, isInternal);
+
+                return;
+            }
+        }
+
+        if (isInternal)
+            return;
+
+        variables.addArrayElement (choc::value::createObject ({},
+                                                              "name", name,
+                                                              "type", type.getLayoutSignature(),
+                                                              "offset", static_cast<int64_t> (offset),
+                                                              "size", static_cast<int64_t> (getPaddedTypeSize (type))));
+    }
+
+    static constexpr uint32_t maxStateLayoutArrayElements = 256;
+
     ::llvm::orc::ThreadSafeModule takeCompiledModule()
     {
         CMAJ_ASSERT (targetModule != nullptr);
@@ -183,9 +348,24 @@ struct LLVMCodeGenerator
     size_t getStateAlignment() { return (getTypeAlignment (*stateStruct)); }
     size_t getIOAlignment()    { return (getTypeAlignment (*ioStruct)); }
 
+    /// Returns a list of the variables in the state struct, with their offsets, so that the
+    /// state of a running performer can be carried over to one built from an edited program.
+    /// Variables with names that begin with an underscore are internal book-keeping (resume
+    /// points, event counts, etc.) whose meaning may change between builds, so are left out.
+    choc::value::Value createStateLayout()
+    {
+        auto variables = choc::value::createEmptyArray();
+        addStateLayoutEntries (variables, *stateStruct, {}, 0, false);
+
+        return choc::value::createObject ({},
+                                          "instanceSize", static_cast<int64_t> (getStateSize()),
+                                          "variables", variables);
+    }
+
     static std::string getInitFunctionName()              { return "initialise"; }
     static std::string getAdvanceOneFrameFunctionName()   { return "advanceOneFrame"; }
     static std::string getAdvanceBlockFunctionName()      { return "advanceBlock"; }
+    static std::string getAdvanceToFrameFunctionName()    { return "advanceToFrame"; }
 
     // parameter variables bigger than this will be passed as a byval pointer to
     // avoid llvm choking on store operations for large arrays
@@ -218,6 +398,7 @@ struct LLVMCodeGenerator
     ptr<AST::StructType> stateStruct, ioStruct;
     ptr<CodeGenerator<LLVMCodeGenerator>> codeGenerator;
     bool useFastMaths = false;
+    BuildSettings::MathsAccuracy mathsAccuracy = BuildSettings::MathsAccuracy::exact;
 
     ::llvm::DataLayout dataLayout;
     choc::value::SimpleStringDictionary& stringDictionary;
@@ -233,6 +414,7 @@ struct LLVMCodeGenerator
     std::unordered_map<const AST::VariableDeclaration*, ::llvm::Value*> localVariables;
     std::unordered_map<const AST::Function*, ::llvm::FunctionCallee> functions;
     std::unordered_map<std::string, void*> externalFunctionPointers;
+    std::unordered_map<std::string, const AST::Function*> externalFunctions;
     std::unordered_map<const AST::VariableDeclaration*, ::llvm::GlobalVariable*> globalVariables;
     DuckTypedStructMappings<::llvm::StructType*, false> structTypes;
     std::vector<std::vector<uint8_t>> gloalVariableSpace;
@@ -336,6 +518,31 @@ struct LLVMCodeGenerator
         return std::string (result.begin(), result.end());
     }
 
+    /// Creates a generic target machine for the module's target triple, which may not be
+    /// the machine that the compiler is running on
+    std::unique_ptr<::llvm::TargetMachine> createTargetMachine()
+    {
+        ::llvm::SmallVector<std::string, 16> attributes {};
+        std::unique_ptr<::llvm::TargetMachine> targetMachine (::llvm::EngineBuilder().selectTarget (::llvm::Triple (targetModule->getTargetTriple()),
+                                                                                                    {}, {}, attributes));
+        if (targetMachine == nullptr)
+            return {};
+
+        if (webAssemblyMode)
+        {
+            if (engineOptions.isObject() && engineOptions.hasObjectMember ("wasm-simd"))
+                targetMachine->setTargetFeatureString ("+simd128");
+        }
+        else
+        {
+            targetMachine->setOptLevel (getCodeGenOptLevel (buildSettings.getOptimisationLevel()));
+            targetMachine->Options.ExceptionModel = ::llvm::ExceptionHandling::None;
+            targetMachine->Options.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
+        }
+
+        return targetMachine;
+    }
+
     std::string printAssembly()
     {
         // llc still uses the legacy passes for printing assembly - is there not a better way yet?
@@ -344,50 +551,222 @@ struct LLVMCodeGenerator
         ::llvm::SmallVector<char, 100000> result;
         ::llvm::raw_svector_ostream ostream (result);
 
-        std::unique_ptr<::llvm::TargetMachine> targetMachine;
+        auto targetMachine = createTargetMachine();
+        ::llvm::legacy::PassManager passManager;
 
-        if (webAssemblyMode)
+        targetMachine.get()->Options.MCOptions.AsmVerbose = true;
+        targetMachine.get()->addPassesToEmitFile (passManager, ostream, nullptr, ::llvm::CodeGenFileType::AssemblyFile);
+        passManager.run (*targetModule);
+
+        return std::string (result.begin(), result.end());
+    }
+
+    //==============================================================================
+    /// An instrumented build holds its profile counters in a global array of int64s with
+    /// this name. Each function that contains conditional branches gets a run of counters:
+    /// one for the number of calls, and then a pair for each branch that count how many
+    /// times it went each way.
+    static std::string_view getProfileCountersName()       { return "_profileCounters"; }
+
+    /// The functions that addProfilingInstrumentation() gave counters to, in the order that
+    /// their counters appear, along with the number of conditional branches in each
+    std::vector<std::pair<std::string, uint32_t>> profiledFunctions;
+
+    /// Counts from an earlier instrumented build, which generate() will use to set the
+    /// branch weights and function entry counts. This is an object with a member for each
+    /// function, containing an array of its counts in the order described above.
+    choc::value::Value profileData;
+
+    /// The machine whose vector widths and costs the optimiser should tune the code for. A
+    /// caller that already has a target machine for the code it's generating should set this
+    /// before calling generate(), otherwise a generic one for the module's triple is used.
+    ::llvm::TargetMachine* optimisationTarget = nullptr;
+
+    template <typename Visitor>
+    void visitProfiledFunctions (Visitor&& visit)
+    {
+        for (auto& fn : *targetModule)
         {
-            ::llvm::SmallVector<std::string, 16> attributes {};
-            targetMachine.reset (::llvm::EngineBuilder().selectTarget (::llvm::Triple (targetModule->getTargetTriple()), {}, {}, attributes));
+            if (fn.isDeclaration())
+                continue;
 
-            if (engineOptions.isObject() && engineOptions.hasObjectMember ("wasm-simd"))
-                targetMachine->setTargetFeatureString ("+simd128");
+            std::vector<::llvm::BranchInst*> branches;
+
+            for (auto& block : fn)
+                if (auto branch = ::llvm::dyn_cast_or_null<::llvm::BranchInst> (block.getTerminator()))
+                    if (branch->isConditional())
+                        branches.push_back (branch);
+
+            if (! branches.empty())
+                visit (fn, branches);
         }
-        else
+    }
+
+    void addProfilingInstrumentation()
+    {
+        uint32_t numCounters = 0;
+
+        visitProfiledFunctions ([&] (::llvm::Function& fn, const std::vector<::llvm::BranchInst*>& branches)
         {
-            if (auto machineBuilder = ::llvm::orc::JITTargetMachineBuilder::detectHost())
+            profiledFunctions.push_back ({ fn.getName().str(), static_cast<uint32_t> (branches.size()) });
+            numCounters += 1 + 2 * static_cast<uint32_t> (branches.size());
+        });
+
+        if (numCounters == 0)
+            return;
+
+        auto int64Type = ::llvm::Type::getInt64Ty (*context);
+        auto arrayType = ::llvm::ArrayType::get (int64Type, numCounters);
+        auto counters = new ::llvm::GlobalVariable (*targetModule, arrayType, false, ::llvm::GlobalValue::ExternalLinkage,
+                                                    ::llvm::ConstantAggregateZero::get (arrayType),
+                                                    std::string (getProfileCountersName()));
+
+        // The increments aren't atomic, so instances rendered on several threads can lose
+        // the odd count, but that doesn't matter for working out which paths are hot
+        auto addToCounter = [&] (::llvm::IRBuilder<>& b, uint32_t index, ::llvm::Value* amount)
+        {
+            auto address = b.CreateConstInBoundsGEP2_32 (arrayType, counters, 0, index);
+            b.CreateStore (b.CreateAdd (b.CreateLoad (int64Type, address), amount), address);
+        };
+
+        uint32_t index = 0;
+
+        visitProfiledFunctions ([&] (::llvm::Function& fn, const std::vector<::llvm::BranchInst*>& branches)
+        {
+            ::llvm::IRBuilder<> b (std::addressof (*fn.getEntryBlock().getFirstInsertionPt()));
+            addToCounter (b, index++, ::llvm::ConstantInt::get (int64Type, 1));
+
+            for (auto branch : branches)
             {
-                auto& opts = machineBuilder->getOptions();
-                opts.ExceptionModel = ::llvm::ExceptionHandling::None;
-                opts.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
+                b.SetInsertPoint (branch);
+                auto taken = b.CreateZExt (branch->getCondition(), int64Type);
+                addToCounter (b, index++, taken);
+                addToCounter (b, index++, b.CreateSub (::llvm::ConstantInt::get (int64Type, 1), taken));
+            }
+        });
+    }
 
-                machineBuilder->setCodeGenOptLevel (getCodeGenOptLevel (buildSettings.getOptimisationLevel()));
+    void applyProfileData (const choc::value::ValueView& profile)
+    {
+        // The counts for a function are only used if it has the same number of branches as
+        // when they were recorded, otherwise the code has changed and they'd be misleading
+        auto getCounts = [&] (::llvm::Function& fn, size_t numBranches) -> std::optional<choc::value::ValueView>
+        {
+            auto name = fn.getName();
+            std::string_view functionName (name.data(), name.size());
+
+            if (profile.hasObjectMember (functionName))
+            {
+                auto counts = profile[functionName];
 
-                if (auto tm = machineBuilder->createTargetMachine())
-                    targetMachine = std::move (tm.get());
+                if (counts.isArray() && counts.size() == 1 + 2 * numBranches)
+                    return counts;
             }
-        }
 
-        ::llvm::legacy::PassManager passManager;
+            return {};
+        };
 
-        targetMachine.get()->Options.MCOptions.AsmVerbose = true;
-        targetMachine.get()->addPassesToEmitFile (passManager, ostream, nullptr, ::llvm::CodeGenFileType::AssemblyFile);
-        passManager.run (*targetModule);
+        auto getCount = [] (const choc::value::ValueView& counts, size_t index)
+        {
+            return static_cast<uint64_t> (std::max (counts[static_cast<uint32_t> (index)].getWithDefault<int64_t> (0), int64_t (0)));
+        };
 
-        return std::string (result.begin(), result.end());
+        uint64_t hottestEntryCount = 0;
+
+        visitProfiledFunctions ([&] (::llvm::Function& fn, const std::vector<::llvm::BranchInst*>& branches)
+        {
+            if (auto counts = getCounts (fn, branches.size()))
+                hottestEntryCount = std::max (hottestEntryCount, getCount (*counts, 0));
+        });
+
+        visitProfiledFunctions ([&] (::llvm::Function& fn, const std::vector<::llvm::BranchInst*>& branches)
+        {
+            auto counts = getCounts (fn, branches.size());
+
+            if (! counts)
+                return;
+
+            auto entryCount = getCount (*counts, 0);
+            fn.setEntryCount (entryCount);
+
+            // Without a profile summary the inliner ignores entry counts, so the hot and
+            // cold functions are also marked with attributes that it does look at
+            if (entryCount == 0)
+                fn.addFnAttr (::llvm::Attribute::Cold);
+            else if (entryCount >= hottestEntryCount / 100)
+                fn.addFnAttr (::llvm::Attribute::InlineHint);
+
+            ::llvm::MDBuilder mdBuilder (*context);
+
+            for (size_t i = 0; i < branches.size(); ++i)
+            {
+                auto taken    = getCount (*counts, 1 + 2 * i);
+                auto notTaken = getCount (*counts, 2 + 2 * i);
+
+                if (taken + notTaken == 0)
+                    continue;
+
+                // Branch weights are 32-bit, and adding one keeps an unseen path from being
+                // treated as impossible
+                auto scale = std::max (taken, notTaken) / std::numeric_limits<uint32_t>::max() + 1;
+
+                branches[i]->setMetadata (::llvm::LLVMContext::MD_prof,
+                                          mdBuilder.createBranchWeights (static_cast<uint32_t> (taken / scale) + 1,
+                                                                         static_cast<uint32_t> (notTaken / scale) + 1));
+            }
+        });
     }
 
+    /// When this is true, generate() only runs the whole-program simplification and inlining
+    /// passes, and the rest of the optimisation and code generation is done per-partition
+    /// by compilePartitionsToObjectCode()
+    bool shouldPartitionModule() const
+    {
+        return ! webAssemblyMode
+                && buildSettings.getCodeGenThreads() > 1
+                && getOptimisationLevelWithDefault (buildSettings.getOptimisationLevel()) > 0;
+    }
+
+    enum class PipelineStage
+    {
+        wholeModule,
+        preLink,
+        postLink
+    };
+
     void applyOptimisationPasses()
     {
-        auto optLevel = getOptimisationLevelWithDefault (buildSettings.getOptimisationLevel());
+        std::unique_ptr<::llvm::TargetMachine> genericTargetMachine;
+        auto targetMachine = optimisationTarget;
 
+        if (targetMachine == nullptr)
+        {
+            genericTargetMachine = createTargetMachine();
+            targetMachine = genericTargetMachine.get();
+        }
+
+        runOptimisationPasses (*targetModule, getOptimisationLevelWithDefault (buildSettings.getOptimisationLevel()),
+                               shouldPartitionModule() ? PipelineStage::preLink : PipelineStage::wholeModule,
+                               targetMachine);
+    }
+
+    /// The target machine gives the optimiser the real vector register widths and costs for the
+    /// CPU, without which the loop and SLP vectorisers assume there are no vector registers at
+    /// all, and leave loops such as the ones that run arrays of graph nodes as scalar code.
+    static void runOptimisationPasses (::llvm::Module& module, int optLevel, PipelineStage stage,
+                                       ::llvm::TargetMachine* targetMachine)
+    {
         ::llvm::LoopAnalysisManager             loopAnalysisManager;
         ::llvm::FunctionAnalysisManager         functionAnalysisManager;
         ::llvm::CGSCCAnalysisManager            cGSCCAnalysisManager;
         ::llvm::ModuleAnalysisManager           moduleAnalysisManager;
 
-        ::llvm::PassBuilder passBuilder;
+        ::llvm::PipelineTuningOptions tuningOptions;
+        tuningOptions.LoopVectorization = optLevel > 1;
+        tuningOptions.LoopInterleaving  = optLevel > 1;
+        tuningOptions.SLPVectorization  = optLevel > 1;
+
+        ::llvm::PassBuilder passBuilder (targetMachine, tuningOptions);
 
         passBuilder.registerModuleAnalyses          (moduleAnalysisManager);
         passBuilder.registerCGSCCAnalyses           (cGSCCAnalysisManager);
@@ -409,13 +788,29 @@ struct LLVMCodeGenerator
                 return ::llvm::OptimizationLevel::O3;
             };
 
-            passBuilder.buildPerModuleDefaultPipeline (getOptimisationLevel())
-                .run (*targetModule, moduleAnalysisManager);
+            switch (stage)
+            {
+                case PipelineStage::preLink:
+                    passBuilder.buildThinLTOPreLinkDefaultPipeline (getOptimisationLevel())
+                        .run (module, moduleAnalysisManager);
+                    break;
+
+                case PipelineStage::postLink:
+                    passBuilder.buildThinLTODefaultPipeline (getOptimisationLevel(), nullptr)
+                        .run (module, moduleAnalysisManager);
+                    break;
+
+                case PipelineStage::wholeModule:
+                default:
+                    passBuilder.buildPerModuleDefaultPipeline (getOptimisationLevel())
+                        .run (module, moduleAnalysisManager);
+                    break;
+            }
         }
         else
         {
             passBuilder.buildO0DefaultPipeline (::llvm::OptimizationLevel::O0)
-                .run (*targetModule, moduleAnalysisManager);
+                .run (module, moduleAnalysisManager);
         }
     }
 
@@ -772,10 +1167,11 @@ struct LLVMCodeGenerator
     {
         if (isExportedFunction (f))
         {
-            if (f.isSystemInitFunction())       return getInitFunctionName();
-            if (f.isMainFunction())             return getAdvanceOneFrameFunctionName();
-            if (f.isSystemAdvanceFunction())    return getAdvanceBlockFunctionName();
-            if (f.isEventHandler)               return codeGenerator->getFunctionName (f);
+            if (f.isSystemInitFunction())               return getInitFunctionName();
+            if (f.isMainFunction())                     return getAdvanceOneFrameFunctionName();
+            if (f.isSystemAdvanceFunction())            return getAdvanceBlockFunctionName();
+            if (f.isSystemAdvanceToFrameFunction())     return getAdvanceToFrameFunctionName();
+            if (f.isEventHandler)                       return codeGenerator->getFunctionName (f);
 
             return std::string (f.getName());
         }
@@ -850,7 +1246,10 @@ struct LLVMCodeGenerator
         functions[std::addressof (f)] = callee;
 
         if (auto customImplementation = program.externalFunctionManager.findResolvedFunction (f))
+        {
             externalFunctionPointers[name] = customImplementation;
+            externalFunctions[name] = std::addressof (f);
+        }
 
         return callee;
     }
@@ -1583,6 +1982,52 @@ struct LLVMCodeGenerator
         return {};
     }
 
+    ValueReader createVectorMathsKernel (AST::Intrinsic::Type intrinsic, ::llvm::ArrayRef<::llvm::Value*> args, const AST::TypeBase& returnType)
+    {
+        if (mathsAccuracy == BuildSettings::MathsAccuracy::exact || ! returnType.isFloatOrVectorOfFloat())
+            return {};
+
+        auto type = args[0]->getType();
+
+        if (! ::llvm::isa<::llvm::FixedVectorType> (type))
+            return {};
+
+        // The 1ulp kernels get their accuracy by working in float64, so there's
+        // nothing more precise to use for a float64 vector than the library
+        bool isFast = mathsAccuracy == BuildSettings::MathsAccuracy::fast;
+
+        if (! (isFast || type->getScalarType()->isFloatTy()))
+            return {};
+
+        auto& b = getBlockBuilder();
+        auto savedFlags = b.getFastMathFlags();
+        b.clearFastMathFlags(); // the kernels need their NaN and INF comparisons to survive
+
+        LLVMVectorMaths maths (b, *targetModule, type, ! isFast);
+        ::llvm::Value* result = nullptr;
+
+        switch (intrinsic)
+        {
+            case AST::Intrinsic::Type::sin:     result = maths.sin (args[0]); break;
+            case AST::Intrinsic::Type::cos:     result = maths.cos (args[0]); break;
+            case AST::Intrinsic::Type::exp:     result = maths.exp (args[0]); break;
+            case AST::Intrinsic::Type::log:     result = maths.log (args[0]); break;
+            case AST::Intrinsic::Type::log10:   result = maths.log10 (args[0]); break;
+
+            // errors in the log are multiplied by the exponent, so only the fast mode uses a kernel
+            case AST::Intrinsic::Type::pow:     if (isFast) result = maths.pow (args[0], args[1]); break;
+
+            default:                            break;
+        }
+
+        b.setFastMathFlags (savedFlags);
+
+        if (result == nullptr)
+            return {};
+
+        return makeReader (result, returnType);
+    }
+
     template <typename FunctionCallArgList>
     ValueReader createIntrinsicCall (AST::Intrinsic::Type intrinsic, FunctionCallArgList argValues, const AST::TypeBase& returnType)
     {
@@ -1596,6 +2041,9 @@ struct LLVMCodeGenerator
                 args.push_back (dereference (arg.valueReader));
         }
 
+        if (auto kernel = createVectorMathsKernel (intrinsic, args, returnType))
+            return kernel;
+
         switch (intrinsic)
         {
             case AST::Intrinsic::Type::abs:           return createIntrinsicCall (::llvm::Intrinsic::fabs,   args, returnType);
@@ -16,6 +16,10 @@
 //  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
 //  DISCLAIMED.
 
+#include <algorithm>
+#include <thread>
+#include <mutex>
+
 #include "../../../include/cmaj_DefaultFlags.h"
 
 #if CMAJ_ENABLE_PERFORMER_LLVM || CMAJ_ENABLE_CODEGEN_LLVM_WASM
@@ -38,8 +42,10 @@
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
@@ -48,6 +54,7 @@
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/MC/TargetRegistry.h"
@@ -83,9 +90,29 @@ static void initialiseLLVM()
 
 #if CMAJ_ENABLE_PERFORMER_LLVM
 
-struct LLJITHolder
+/// A process-wide set of LLJIT instances, one per code-gen optimisation level, which
+/// are shared by all the programs that get linked. Each program gets its own JITDylib
+/// inside the shared ExecutionSession, so that symbol names can't clash, and removing
+/// that JITDylib releases the program's code memory without affecting any others.
+struct SharedJIT
 {
-    LLJITHolder (int optimisationLevel)
+    static std::shared_ptr<SharedJIT> get (::llvm::CodeGenOptLevel optLevel)
+    {
+        static std::mutex lock;
+        static std::unordered_map<int, std::weak_ptr<SharedJIT>> instances;
+
+        std::lock_guard<std::mutex> l (lock);
+        auto& instance = instances[static_cast<int> (optLevel)];
+
+        if (auto existing = instance.lock())
+            return existing;
+
+        auto newInstance = std::make_shared<SharedJIT> (optLevel);
+        instance = newInstance;
+        return newInstance;
+    }
+
+    SharedJIT (::llvm::CodeGenOptLevel optLevel)
     {
         ::llvm::sys::DynamicLibrary::LoadLibraryPermanently (nullptr);
 
@@ -97,7 +124,9 @@ struct LLJITHolder
             opts.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
             opts.setFP32DenormalMode (::llvm::DenormalMode::getPositiveZero());
 
-            machineBuilder->setCodeGenOptLevel (getCodeGenOptLevel (optimisationLevel));
+            machineBuilder->setCodeGenOptLevel (optLevel);
+
+            targetMachineBuilder = machineBuilder.get();
 
             ::llvm::orc::LLJITBuilder builder;
             builder.setJITTargetMachineBuilder (machineBuilder.get());
@@ -130,32 +159,111 @@ struct LLJITHolder
         CMAJ_ASSERT_FALSE;
     }
 
+    ::llvm::orc::JITDylib& createDylib()
+    {
+        static std::atomic<uint64_t> nextDylibID { 0 };
+        auto name = "cmaj_program_" + std::to_string (++nextDylibID);
+
+        auto dylib = lljit->getExecutionSession().createJITDylib (name);
+
+        if (auto e = dylib.takeError())
+            throwError (Errors::failedToJit (toString (std::move (e))));
+
+        dylib->addToLinkOrder (lljit->getMainJITDylib());
+        return *dylib;
+    }
+
+    void removeDylib (::llvm::orc::JITDylib& dylib)
+    {
+        if (auto err = lljit->getExecutionSession().removeJITDylib (dylib))
+            ::llvm::consumeError (std::move (err));
+    }
+
+    std::unique_ptr<::llvm::orc::LLJIT> lljit;
+    std::optional<::llvm::orc::JITTargetMachineBuilder> targetMachineBuilder;
+};
+
+//==============================================================================
+struct LLJITHolder
+{
+    LLJITHolder (int optimisationLevel)
+        : jit (SharedJIT::get (getCodeGenOptLevel (optimisationLevel))),
+          lljit (*jit->lljit),
+          dylib (jit->createDylib())
+    {
+    }
+
+    ~LLJITHolder()
+    {
+        jit->removeDylib (dylib);
+    }
+
     void load (::llvm::orc::ThreadSafeModule&& module)
     {
-        auto err = lljit->addIRModule (std::move (module));
+        auto err = lljit.addIRModule (dylib, std::move (module));
         CMAJ_ASSERT (! err);
-        err = lljit->initialize (lljit->getMainJITDylib());
+        err = lljit.initialize (dylib);
         CMAJ_ASSERT (! err);
     }
 
-    void addExternalFunctionSymbols (const std::unordered_map<std::string, void*>& functionPointers)
+    void loadObjectCode (std::unique_ptr<::llvm::MemoryBuffer> objectCode)
+    {
+        std::vector<std::unique_ptr<::llvm::MemoryBuffer>> objectFiles;
+        objectFiles.push_back (std::move (objectCode));
+        loadObjectCode (std::move (objectFiles));
+    }
+
+    void loadObjectCode (std::vector<std::unique_ptr<::llvm::MemoryBuffer>> objectFiles)
     {
-        auto& processSymbols = lljit->getMainJITDylib();
+        for (auto& objectCode : objectFiles)
+            if (auto err = lljit.addObjectFile (dylib, std::move (objectCode)))
+                throwError (Errors::failedToJit (toString (std::move (err))));
+
+        auto err = lljit.initialize (dylib);
+        CMAJ_ASSERT (! err);
+    }
+
+    std::unique_ptr<::llvm::TargetMachine> createTargetMachine()
+    {
+        if (auto tm = jit->targetMachineBuilder->createTargetMachine())
+            return std::move (*tm);
+
+        throwError (Errors::failedToJit ("Failed to create target machine"));
+        return {};
+    }
+
+    /// A string that identifies the triple, CPU and feature set that object code is compiled
+    /// for, so that cached object files are never loaded on a machine they weren't built for
+    static const std::string& getHostTargetDescription()
+    {
+        static const std::string description = []
+        {
+            if (auto machineBuilder = ::llvm::orc::JITTargetMachineBuilder::detectHost())
+                return machineBuilder->getTargetTriple().normalize() + " " + machineBuilder->getCPU()
+                         + " " + machineBuilder->getFeatures().getString();
 
+            return std::string();
+        }();
+
+        return description;
+    }
+
+    void addExternalFunctionSymbols (const std::unordered_map<std::string, void*>& functionPointers)
+    {
         for (auto& f : functionPointers)
         {
-            auto mangledName = lljit->mangleAndIntern (f.first);
+            auto mangledName = lljit.mangleAndIntern (f.first);
             auto pointer = ::llvm::JITEvaluatedSymbol::fromPointer (f.second);
 
           #if (LLVM_VERSION_MAJOR <= 15)
-            if (processSymbols.define (::llvm::orc::absoluteSymbols ({{ mangledName, pointer }})))
+            if (dylib.define (::llvm::orc::absoluteSymbols ({{ mangledName, pointer }})))
             {
                 // handle failure?
             }
           #else
             auto symbol = ::llvm::orc::ExecutorSymbolDef (::llvm::orc::ExecutorAddr (pointer.getAddress()), pointer.getFlags());
 
-            if (processSymbols.define (::llvm::orc::absoluteSymbols ({{ mangledName, symbol }})))
+            if (dylib.define (::llvm::orc::absoluteSymbols ({{ mangledName, symbol }})))
             {
                 // handle failure?
             }
@@ -165,17 +273,22 @@ struct LLJITHolder
 
     void* findSymbol (std::string_view name)
     {
-        if (auto result = lljit->lookup (std::string (name)))
+        auto result = lljit.lookup (dylib, std::string (name));
+
+        if (result)
             return reinterpret_cast<void*> (result.get().getValue());
 
+        ::llvm::consumeError (result.takeError());
         return nullptr;
     }
 
-    std::string getTargetTriple() const         { return lljit->getTargetTriple().normalize(); }
-    const ::llvm::DataLayout& getDataLayout()   { return lljit->getDataLayout(); }
+    std::string getTargetTriple() const         { return lljit.getTargetTriple().normalize(); }
+    const ::llvm::DataLayout& getDataLayout()   { return lljit.getDataLayout(); }
 
 private:
-    std::unique_ptr<::llvm::orc::LLJIT> lljit;
+    std::shared_ptr<SharedJIT> jit;
+    ::llvm::orc::LLJIT& lljit;
+    ::llvm::orc::JITDylib& dylib;
 
     static ::llvm::CodeGenOptLevel getCodeGenOptLevel (int level)
     {
@@ -210,6 +323,7 @@ struct LLVMEngine
     static constexpr bool usesDynamicRateAndSessionID = false;
     static constexpr bool allowTopLevelSlices = false;
     static constexpr bool supportsExternalFunctions = true;
+    static constexpr bool canLinkFromCachedCode = true;
     static bool engineSupportsIntrinsic (AST::Intrinsic::Type) { return true; }
 
     using InitialiseFn       = void*(*)(void*, int32_t*, int32_t, double);
@@ -220,6 +334,55 @@ struct LLVMEngine
     //==============================================================================
     struct LinkedCode
     {
+        /// The contents of a cache entry written by saveObjectCodeToCache()
+        struct CachedObjectCode
+        {
+            bool load (CacheDatabaseInterface& cache, const char* key)
+            {
+                if (auto cachedSize = cache.reload (key, nullptr, 0))
+                {
+                    std::vector<char> loaded;
+                    loaded.resize (static_cast<size_t> (cachedSize));
+
+                    if (cache.reload (key, loaded.data(), cachedSize) == cachedSize)
+                    {
+                        choc::span<char> data (loaded);
+
+                        if (LLVMCodeGenerator::readDictionary (stringDictionary, data) && data.size() >= sizeof (uint32_t))
+                        {
+                            auto linkInfoSize = choc::memory::readLittleEndian<uint32_t> (data.data());
+                            data = { data.begin() + sizeof (uint32_t), data.end() };
+
+                            if (data.size() >= linkInfoSize)
+                            {
+                                if (linkInfoSize != 0)
+                                {
+                                    try
+                                    {
+                                        choc::value::InputData input { reinterpret_cast<const uint8_t*> (data.data()),
+                                                                       reinterpret_cast<const uint8_t*> (data.data() + linkInfoSize) };
+                                        linkInfo = choc::value::Value::deserialise (input);
+                                    }
+                                    catch (...) {}
+                                }
+
+                                data = { data.begin() + linkInfoSize, data.end() };
+                                objectCode = ::llvm::MemoryBuffer::getMemBufferCopy ({ data.begin(), data.size() }, "cmajor_cached");
+                                return true;
+                            }
+                        }
+                    }
+                }
+
+                return false;
+            }
+
+            choc::value::SimpleStringDictionary stringDictionary;
+            choc::value::Value linkInfo;
+            std::unique_ptr<::llvm::MemoryBuffer> objectCode;
+        };
+
+        //==============================================================================
         LinkedCode (LLVMEngine& llvmEngine, bool isSingleFrameOnly, double latencyToUse,
                     CacheDatabaseInterface* cache, const char* cacheKey)
            : lljit (llvmEngine.engine.buildSettings.getOptimisationLevel()),
@@ -235,18 +398,78 @@ struct LLVMEngine
 
             codeGen.addNativeOverriddenFunctions (llvmEngine.engine.program->externalFunctionManager);
 
-            bool loadedFromCache = loadFromCache (codeGen, cache, cacheKey);
+            auto& buildSettings = llvmEngine.engine.buildSettings;
+
+            // An instrumented build is always compiled from scratch, so that the layout of its
+            // counters is known, and its counts are saved to the cache when it's destroyed
+            bool isInstrumented = buildSettings.shouldInstrumentForProfiling();
+
+            if (cache != nullptr && (isInstrumented || buildSettings.shouldUseProfileData()))
+            {
+                profileCacheKey = llvmEngine.engine.getProfileCacheKey();
+
+                if (isInstrumented)
+                    profileCache = CacheDatabaseInterface::Ptr (cache);
+                else
+                    codeGen.profileData = loadProfile (*cache, profileCacheKey);
+            }
+
+            bool useObjectCache = cache != nullptr && buildSettings.shouldCacheObjectCode() && ! isInstrumented;
+            std::string objectCacheKey;
+            CachedObjectCode cachedObject;
+            bool loadedFromCache = false;
+            std::unordered_map<std::string, void*> externalFunctionPointers;
+
+            if (useObjectCache)
+            {
+                objectCacheKey = getObjectCacheKey (cacheKey);
+                loadedFromCache = cachedObject.load (*cache, objectCacheKey.c_str())
+                                   && findExternalFunctions (cachedObject.linkInfo, llvmEngine.engine.program->externalFunctionManager,
+                                                             externalFunctionPointers);
+
+                if (loadedFromCache)
+                    stringDictionary = std::move (cachedObject.stringDictionary);
+            }
+            else if (! isInstrumented)
+            {
+                loadedFromCache = loadFromCache (codeGen, cache, cacheKey);
+            }
+
+            // The JIT's target machine comes from a builder that the shared JIT set up when it
+            // was created, so the host's CPU doesn't need to be detected again for each link
+            std::unique_ptr<::llvm::TargetMachine> targetMachine;
+
+            if (! loadedFromCache)
+            {
+                targetMachine = lljit.createTargetMachine();
+                codeGen.optimisationTarget = targetMachine.get();
+            }
 
             if (! (loadedFromCache || codeGen.generate()))
             {
                 CMAJ_ASSERT_FALSE;
             }
 
+            if (! (useObjectCache && loadedFromCache))
+                externalFunctionPointers = codeGen.externalFunctionPointers;
+
             nativeTypeLayouts.createLayout = [&codeGen] (const AST::TypeBase& t) { return codeGen.createNativeTypeLayout (t); };
 
             stateSize = codeGen.getStateSize();
             ioSize = codeGen.getIOSize();
 
+            // Slices hold raw pointers, which would be meaningless in another instance's state
+            stateCanBeCopied = ! codeGen.stateStruct->containsSlice();
+
+            // The layout depends on the code generator's types, so must be collected now, but
+            // it's only turned into JSON if something asks for it
+            if (stateCanBeCopied)
+                stateLayout = codeGen.createStateLayout();
+
+            // Host functions may not return the same results each time they're called, so
+            // programs that use them must always re-run their init code when reset
+            initialStateCanBeCached = stateCanBeCopied && externalFunctionPointers.empty();
+
             auto alignmentBits = std::max (codeGen.getStateAlignment(), codeGen.getIOAlignment());
 
             if (alignmentBits > alignmentBytes * 8)
@@ -254,21 +477,66 @@ struct LLVMEngine
 
             initialiseEndpointHandlers (codeGen, llvmEngine.engine.endpointHandles);
 
-            if (cache != nullptr && ! loadedFromCache)
-                codeGen.saveBitcodeToCache (*cache, cacheKey);
+            lljit.addExternalFunctionSymbols (externalFunctionPointers);
 
-            lljit.addExternalFunctionSymbols (codeGen.externalFunctionPointers);
-            lljit.load (codeGen.takeCompiledModule());
+            if (useObjectCache)
+            {
+                if (! loadedFromCache)
+                {
+                    cachedObject.objectCode = codeGen.compileToObjectCode (*targetMachine);
 
-            loadFunction (initialiseFn, LLVMCodeGenerator::getInitFunctionName());
+                    // Programs that call out to host functions also store the name and parameter
+                    // types of each one, so that its symbol can be bound to whatever the host
+                    // supplies when the object code is reloaded
+                    auto linkInfo = createLinkInfo (llvmEngine.engine.endpointHandles);
 
-            if (isSingleFrameOnly)
-                loadFunction (advanceOneFrameFn, LLVMCodeGenerator::getAdvanceOneFrameFunctionName());
+                    if (! codeGen.externalFunctions.empty())
+                        linkInfo.addMember ("externalFunctions", createExternalFunctionList (codeGen.externalFunctions));
+
+                    auto linkInfoData = linkInfo.serialise().data;
+
+                    codeGen.saveObjectCodeToCache (*cache, objectCacheKey.c_str(), *cachedObject.objectCode,
+                                                   { linkInfoData.data(), linkInfoData.size() });
+                }
+
+                lljit.loadObjectCode (std::move (cachedObject.objectCode));
+            }
             else
-                loadFunction (advanceBlockFn, LLVMCodeGenerator::getAdvanceBlockFunctionName());
+            {
+                if (cache != nullptr && ! loadedFromCache && ! isInstrumented)
+                    codeGen.saveBitcodeToCache (*cache, cacheKey);
 
-            for (auto& e : inputValues)
-                loadFunction (e.setValue, e.setValueFnName);
+                if (codeGen.shouldPartitionModule())
+                    lljit.loadObjectCode (codeGen.compilePartitionsToObjectCode ([this] { return lljit.createTargetMachine(); }));
+                else
+                    lljit.load (codeGen.takeCompiledModule());
+            }
+
+            loadFunctions (isSingleFrameOnly);
+
+            if (isInstrumented && ! codeGen.profiledFunctions.empty())
+            {
+                profiledFunctions = codeGen.profiledFunctions;
+                profileCounters = static_cast<const int64_t*> (lljit.findSymbol (LLVMCodeGenerator::getProfileCountersName()));
+            }
+        }
+
+        ~LinkedCode()
+        {
+            saveProfile();
+        }
+
+        /// Re-creates a previously linked program from the object code and link info that
+        /// was stored in the cache, without needing the code-gen transformations to have run
+        LinkedCode (LLVMEngine& llvmEngine, bool isSingleFrameOnly, CachedObjectCode&& cachedObject)
+           : lljit (llvmEngine.engine.buildSettings.getOptimisationLevel()),
+             stringDictionary (std::move (cachedObject.stringDictionary))
+        {
+            if (! restoreFromLinkInfo (cachedObject.linkInfo, llvmEngine.engine.endpointHandles))
+                throwError (Errors::failedToLink ("Cached program does not match the active endpoints"));
+
+            lljit.loadObjectCode (std::move (cachedObject.objectCode));
+            loadFunctions (isSingleFrameOnly);
         }
 
         //==============================================================================
@@ -276,13 +544,121 @@ struct LLVMEngine
         choc::value::SimpleStringDictionary stringDictionary;
         NativeTypeLayoutCache nativeTypeLayouts;
         size_t stateSize = 0, ioSize = 0;
+        bool stateCanBeCopied = false, initialStateCanBeCached = false;
+        choc::value::Value stateLayout;
+        mutable std::string stateLayoutJSON;
+        mutable std::once_flag stateLayoutJSONCreated;
         static constexpr size_t alignmentBytes = 128;
 
-        double latency;
+        double latency = 0;
 
         InitialiseFn        initialiseFn = {};
         AdvanceOneFrameFn   advanceOneFrameFn = {};
         AdvanceBlockFn      advanceBlockFn = {};
+        AdvanceBlockFn      advanceToFrameFn = {};
+
+        //==============================================================================
+        /// The contents of a performer's state after its init code has run. This only
+        /// depends on the session ID and frequency, so is computed once and then copied
+        /// into each instance that gets reset with the same settings.
+        struct InitialState
+        {
+            int32_t sessionID = 0;
+            double frequency = 0;
+            choc::AlignedMemoryBlock<alignmentBytes> state;
+        };
+
+        std::shared_ptr<const InitialState> getInitialState (int32_t sessionID, double frequency)
+        {
+            if (! initialStateCanBeCached)
+                return {};
+
+            std::scoped_lock sl (initialStateLock);
+
+            for (auto& s : initialStates)
+                if (s->sessionID == sessionID && s->frequency == frequency)
+                    return s;
+
+            auto newState = std::make_shared<InitialState>();
+            newState->sessionID = sessionID;
+            newState->frequency = frequency;
+            newState->state.resize (stateSize);
+            newState->state.clear();
+
+            int processorID = 0;
+            initialiseFn (static_cast<uint8_t*> (newState->state.data()), &processorID, sessionID, frequency);
+
+            // Each session ID needs its own image, so to stop the list growing for as long as the
+            // code is alive, any that are no longer used by an instance are dropped. Instances only
+            // take a reference while this lock is held, so a count of 1 can't be about to go up.
+            initialStates.erase (std::remove_if (initialStates.begin(), initialStates.end(),
+                                                 [] (auto& s) { return s.use_count() == 1; }),
+                                 initialStates.end());
+
+            initialStates.push_back (newState);
+            return newState;
+        }
+
+        std::mutex initialStateLock;
+        std::vector<std::shared_ptr<const InitialState>> initialStates;
+
+        //==============================================================================
+        CacheDatabaseInterface::Ptr profileCache;
+        std::string profileCacheKey;
+        std::vector<std::pair<std::string, uint32_t>> profiledFunctions;
+        const int64_t* profileCounters = nullptr;
+
+        static choc::value::Value loadProfile (CacheDatabaseInterface& cache, const std::string& key)
+        {
+            if (auto cachedSize = cache.reload (key.c_str(), nullptr, 0))
+            {
+                std::vector<uint8_t> loaded (static_cast<size_t> (cachedSize));
+
+                if (cache.reload (key.c_str(), loaded.data(), cachedSize) == cachedSize)
+                {
+                    try
+                    {
+                        choc::value::InputData input { loaded.data(), loaded.data() + loaded.size() };
+                        return choc::value::Value::deserialise (input);
+                    }
+                    catch (...) {}
+                }
+            }
+
+            return {};
+        }
+
+        /// Adds this build's counts to any that earlier runs stored in the cache, so that
+        /// several renders with different material can all contribute to the profile
+        void saveProfile()
+        {
+            if (profileCounters == nullptr || profileCache == nullptr)
+                return;
+
+            auto previous = loadProfile (*profileCache, profileCacheKey);
+            auto profile = choc::value::createObject ({});
+            auto counter = profileCounters;
+
+            for (auto& [name, numBranches] : profiledFunctions)
+            {
+                auto numCounts = 1 + 2 * numBranches;
+                auto counts = choc::value::createEmptyArray();
+
+                bool canMerge = previous.isObject()
+                                  && previous.hasObjectMember (name)
+                                  && previous[name].isArray()
+                                  && previous[name].size() == numCounts;
+
+                for (uint32_t i = 0; i < numCounts; ++i)
+                    counts.addArrayElement (counter[i] + (canMerge ? previous[name][i].getWithDefault<int64_t> (0) : 0));
+
+                profile.setMember (name, counts);
+                counter += numCounts;
+            }
+
+            auto data = profile.serialise().data;
+            profileCache->store (profileCacheKey.c_str(), data.data(), data.size());
+        }
 
         //==============================================================================
         struct InputStreamEndpoint
@@ -301,6 +677,38 @@ struct LLVMEngine
             SetValueRampFn setValue = {};
         };
 
+        struct InputEventEndpoint
+        {
+            EndpointHandle handle;
+
+            enum class ArgumentType
+            {
+                none, int32, int64, float32, float64, stringHandle, pointer
+            };
+
+            struct EventTypeHandler
+            {
+                std::string functionName;
+                ArgumentType argumentType = ArgumentType::none;
+                ptr<const NativeTypeLayout> layout;
+            };
+
+            std::vector<EventTypeHandler> eventTypeHandlers;
+
+            static ArgumentType getArgumentType (const AST::TypeBase& type)
+            {
+                if (type.isVoid())              return ArgumentType::none;
+                if (type.isPrimitiveInt32())    return ArgumentType::int32;
+                if (type.isPrimitiveInt64())    return ArgumentType::int64;
+                if (type.isPrimitiveFloat32())  return ArgumentType::float32;
+                if (type.isPrimitiveFloat64())  return ArgumentType::float64;
+                if (type.isPrimitiveBool())     return ArgumentType::int32;
+                if (type.isPrimitiveString())   return ArgumentType::stringHandle;
+
+                return ArgumentType::pointer;
+            }
+        };
+
         struct OutputStreamEndpoint
         {
             EndpointHandle handle;
@@ -332,6 +740,7 @@ struct LLVMEngine
 
         std::vector<InputStreamEndpoint>  inputStreams;
         std::vector<InputValueEndpoint>   inputValues;
+        std::vector<InputEventEndpoint>   inputEvents;
         std::vector<OutputStreamEndpoint> outputStreams;
         std::vector<OutputValueEndpoint>  outputValues;
         std::vector<OutputEventEndpoint>  outputEvents;
@@ -353,7 +762,46 @@ struct LLVMEngine
             return false;
         }
 
+        /// Only serialised the first time a performer asks for it, which most never do
+        const std::string& getStateLayoutJSON() const
+        {
+            std::call_once (stateLayoutJSONCreated, [this]
+            {
+                if (stateLayout.isString()) // link info stored by older builds holds the JSON itself
+                    stateLayoutJSON = stateLayout.getString();
+                else if (stateLayout.isObject())
+                    stateLayoutJSON = choc::json::toString (stateLayout);
+            });
+
+            return stateLayoutJSON;
+        }
+
+        static std::string getObjectCacheKey (const char* cacheKey)
+        {
+            choc::hash::xxHash64 hash;
+            hash.addInput (LLJITHolder::getHostTargetDescription());
+            return std::string (cacheKey) + "_obj_" + choc::text::createHexString (hash.getHash());
+        }
+
         //==============================================================================
+        void loadFunctions (bool isSingleFrameOnly)
+        {
+            loadFunction (initialiseFn, LLVMCodeGenerator::getInitFunctionName());
+
+            if (isSingleFrameOnly)
+                loadFunction (advanceOneFrameFn, LLVMCodeGenerator::getAdvanceOneFrameFunctionName());
+            else
+            {
+                loadFunction (advanceBlockFn, LLVMCodeGenerator::getAdvanceBlockFunctionName());
+
+                // this is optional, as a cached object file may pre-date it
+                advanceToFrameFn = reinterpret_cast<AdvanceBlockFn> (lljit.findSymbol (LLVMCodeGenerator::getAdvanceToFrameFunctionName()));
+            }
+
+            for (auto& e : inputValues)
+                loadFunction (e.setValue, e.setValueFnName);
+        }
+
         void initialiseEndpointHandlers (LLVMCodeGenerator& codeGen, const std::vector<EndpointInfo>& endpointArray)
         {
             for (auto& endpoint : endpointArray)
@@ -383,8 +831,21 @@ struct LLVMEngine
                     }
                     else if (endpoint.details.isEvent())
                     {
+                        inputEvents.push_back ({ handle, {} });
+
                         for (auto& dataType : endpoint.endpoint.getDataTypes())
-                            nativeTypeLayouts.get (dataType);
+                        {
+                            InputEventEndpoint::EventTypeHandler handler;
+
+                            if (auto f = AST::findEventHandlerFunction (endpoint.endpoint, dataType))
+                            {
+                                handler.functionName = AST::getEventHandlerFunctionName (*f);
+                                handler.argumentType = InputEventEndpoint::getArgumentType (dataType);
+                            }
+
+                            handler.layout = nativeTypeLayouts.get (dataType);
+                            inputEvents.back().eventTypeHandlers.push_back (std::move (handler));
+                        }
                     }
                 }
                 else
@@ -433,6 +894,282 @@ struct LLVMEngine
             }
         }
 
+        //==============================================================================
+        // The link info holds everything about the transformed program that the performer
+        // needs, so that a cache hit can skip the code-gen transformations entirely.
+        choc::value::Value createLinkInfo (const std::vector<EndpointInfo>& endpointArray) const
+        {
+            auto toInt = [] (size_t n) { return static_cast<int64_t> (n); };
+
+            auto findEndpointID = [&endpointArray] (EndpointHandle handle) -> std::string
+            {
+                for (auto& e : endpointArray)
+                    if (e.handle == handle)
+                        return e.details.endpointID.toString();
+
+                CMAJ_ASSERT_FALSE;
+            };
+
+            auto info = choc::value::createObject ({},
+                                                   "stateSize", toInt (stateSize),
+                                                   "ioSize", toInt (ioSize),
+                                                   "stateCanBeCopied", stateCanBeCopied,
+                                                   "latency", latency);
+
+            if (stateLayout.isObject())
+                info.addMember ("stateLayout", stateLayout);
+
+            auto streams = [&] (const auto& list)
+            {
+                auto result = choc::value::createEmptyArray();
+
+                for (auto& e : list)
+                    result.addArrayElement (choc::value::createObject ({},
+                                                                       "id", findEndpointID (e.handle),
+                                                                       "offset", toInt (e.addressOffset),
+                                                                       "frameSize", toInt (e.frameSize),
+                                                                       "frameStride", toInt (e.frameStride),
+                                                                       "layout", e.frameLayout->getChunksAsValue()));
+                return result;
+            };
+
+            info.addMember ("inputStreams", streams (inputStreams));
+            info.addMember ("outputStreams", streams (outputStreams));
+
+            auto values = choc::value::createEmptyArray();
+
+            for (auto& e : inputValues)
+                values.addArrayElement (choc::value::createObject ({},
+                                                                   "id", findEndpointID (e.handle),
+                                                                   "dataSize", toInt (e.dataSize),
+                                                                   "layout", e.layout->getChunksAsValue(),
+                                                                   "setValueFn", e.setValueFnName));
+
+            info.addMember ("inputValues", values);
+
+            auto inEvents = choc::value::createEmptyArray();
+
+            for (auto& e : inputEvents)
+            {
+                auto types = choc::value::createEmptyArray();
+
+                for (auto& t : e.eventTypeHandlers)
+                    types.addArrayElement (choc::value::createObject ({},
+                                                                      "handler", t.functionName,
+                                                                      "argumentType", static_cast<int32_t> (t.argumentType),
+                                                                      "layout", t.layout->getChunksAsValue()));
+
+                inEvents.addArrayElement (choc::value::createObject ({},
+                                                                     "id", findEndpointID (e.handle),
+                                                                     "types", types));
+            }
+
+            info.addMember ("inputEvents", inEvents);
+
+            auto outValues = choc::value::createEmptyArray();
+
+            for (auto& e : outputValues)
+                outValues.addArrayElement (choc::value::createObject ({},
+                                                                      "id", findEndpointID (e.handle),
+                                                                      "offset", toInt (e.addressOffset),
+                                                                      "layout", e.layout->getChunksAsValue()));
+
+            info.addMember ("outputValues", outValues);
+
+            auto outEvents = choc::value::createEmptyArray();
+
+            for (auto& e : outputEvents)
+            {
+                auto types = choc::value::createEmptyArray();
+
+                for (auto& t : e.eventTypeHandlers)
+                    types.addArrayElement (choc::value::createObject ({},
+                                                                      "offset", static_cast<int32_t> (t.offset),
+                                                                      "layout", t.layout->getChunksAsValue()));
+
+                outEvents.addArrayElement (choc::value::createObject ({},
+                                                                      "id", findEndpointID (e.handle),
+                                                                      "countOffset", toInt (e.eventCountAddressOffset),
+                                                                      "listOffset", toInt (e.eventListStartAddressOffset),
+                                                                      "stride", toInt (e.eventListElementStride),
+                                                                      "typeOffset", toInt (e.typeFieldOffset),
+                                                                      "types", types));
+            }
+
+            info.addMember ("outputEvents", outEvents);
+            return info;
+        }
+
+        static choc::value::Value createExternalFunctionList (const std::unordered_map<std::string, const AST::Function*>& functions)
+        {
+            auto list = choc::value::createEmptyArray();
+
+            for (auto& [symbol, f] : functions)
+                list.addArrayElement (choc::value::createObject ({},
+                                                                 "symbol", symbol,
+                                                                 "name", f->getFullyQualifiedReadableName(),
+                                                                 "parameterTypes", AST::ExternalFunctionManager::getParameterTypesJSON (*f)));
+
+            return list;
+        }
+
+        /// Looks up the host functions that a cached program calls, returning false if the link
+        /// info is missing or one of them can't be found, in which case the code must be rebuilt.
+        static bool findExternalFunctions (const choc::value::ValueView& linkInfo, const AST::ExternalFunctionManager& externalFunctionManager,
+                                           std::unordered_map<std::string, void*>& result)
+        {
+            if (! linkInfo.isObject())
+                return false;
+
+            if (linkInfo.hasObjectMember ("externalFunctions"))
+            {
+                for (auto f : linkInfo["externalFunctions"])
+                {
+                    auto fn = externalFunctionManager.findResolvedFunction (f["name"].toString(), f["parameterTypes"].toString());
+
+                    if (fn == nullptr)
+                        return false;
+
+                    result[f["symbol"].toString()] = fn;
+                }
+            }
+
+            return true;
+        }
+
+        bool restoreFromLinkInfo (const choc::value::ValueView& info, const std::vector<EndpointInfo>& endpointArray)
+        {
+            if (! info.isObject())
+                return false;
+
+            auto getSize = [] (const choc::value::ValueView& v, std::string_view name)
+            {
+                return static_cast<size_t> (v[name].getWithDefault<int64_t> (0));
+            };
+
+            stateSize = getSize (info, "stateSize");
+            ioSize    = getSize (info, "ioSize");
+            latency   = info["latency"].getWithDefault<double> (0);
+            stateCanBeCopied = info["stateCanBeCopied"].getWithDefault<bool> (false);
+            stateLayout = info.hasObjectMember ("stateLayout") ? choc::value::Value (info["stateLayout"])
+                                                                : choc::value::Value();
+            initialStateCanBeCached = stateCanBeCopied; // programs with host functions are never restored from link info alone
+
+            auto findEntry = [] (const choc::value::ValueView& list, const std::string& endpointID) -> std::optional<choc::value::ValueView>
+            {
+                if (list.isArray())
+                    for (auto item : list)
+                        if (item["id"].toString() == endpointID)
+                            return item;
+
+                return {};
+            };
+
+            auto restoreLayout = [this] (const AST::TypeBase& type, const choc::value::ValueView& chunks) -> ptr<const NativeTypeLayout>
+            {
+                auto layout = std::make_unique<NativeTypeLayout> (type);
+
+                if (! layout->restoreChunks (chunks))
+                    return {};
+
+                auto result = layout.get();
+                nativeTypeLayouts.nativeTypeLayouts.push_back (std::move (layout));
+                return ptr<const NativeTypeLayout> (result);
+            };
+
+            for (auto& endpoint : endpointArray)
+            {
+                auto handle = endpoint.handle;
+                auto endpointID = endpoint.details.endpointID.toString();
+                auto dataTypes = endpoint.endpoint.getDataTypes();
+
+                if (endpoint.details.isStream())
+                {
+                    auto entry = findEntry (info[endpoint.details.isInput ? "inputStreams" : "outputStreams"], endpointID);
+
+                    if (! entry)
+                        return false;
+
+                    auto& e = *entry;
+                    auto layout = restoreLayout (dataTypes.front(), e["layout"]);
+
+                    if (layout == nullptr)
+                        return false;
+
+                    if (endpoint.details.isInput)
+                        inputStreams.push_back ({ handle, getSize (e, "offset"), getSize (e, "frameSize"), getSize (e, "frameStride"), layout });
+                    else
+                        outputStreams.push_back ({ handle, getSize (e, "offset"), getSize (e, "frameSize"), getSize (e, "frameStride"), layout });
+                }
+                else if (endpoint.details.isValue())
+                {
+                    auto entry = findEntry (info[endpoint.details.isInput ? "inputValues" : "outputValues"], endpointID);
+
+                    if (! entry)
+                        return false;
+
+                    auto& e = *entry;
+                    auto layout = restoreLayout (dataTypes.front(), e["layout"]);
+
+                    if (layout == nullptr)
+                        return false;
+
+                    if (endpoint.details.isInput)
+                        inputValues.push_back ({ handle, getSize (e, "dataSize"), layout, e["setValueFn"].toString(), nullptr });
+                    else
+                        outputValues.push_back ({ handle, getSize (e, "offset"), layout });
+                }
+                else if (endpoint.details.isEvent())
+                {
+                    auto entry = findEntry (info[endpoint.details.isInput ? "inputEvents" : "outputEvents"], endpointID);
+
+                    if (! entry)
+                        return false;
+
+                    auto& e = *entry;
+                    auto types = e["types"];
+
+                    if (! types.isArray() || types.size() != dataTypes.size())
+                        return false;
+
+                    if (endpoint.details.isInput)
+                    {
+                        inputEvents.push_back ({ handle, {} });
+
+                        for (uint32_t i = 0; i < types.size(); ++i)
+                        {
+                            auto layout = restoreLayout (dataTypes[i], types[i]["layout"]);
+
+                            if (layout == nullptr)
+                                return false;
+
+                            inputEvents.back().eventTypeHandlers.push_back ({ types[i]["handler"].toString(),
+                                                                              static_cast<InputEventEndpoint::ArgumentType> (types[i]["argumentType"].getWithDefault<int32_t> (0)),
+                                                                              layout });
+                        }
+                    }
+                    else
+                    {
+                        outputEvents.push_back ({ handle, getSize (e, "countOffset"), getSize (e, "listOffset"),
+                                                  getSize (e, "stride"), getSize (e, "typeOffset") });
+
+                        for (uint32_t i = 0; i < types.size(); ++i)
+                        {
+                            auto layout = restoreLayout (dataTypes[i], types[i]["layout"]);
+
+                            if (layout == nullptr)
+                                return false;
+
+                            outputEvents.back().eventTypeHandlers.push_back ({ static_cast<uint32_t> (types[i]["offset"].getWithDefault<int32_t> (0)),
+                                                                               layout });
+                        }
+                    }
+                }
+            }
+
+            return true;
+        }
+
         template <typename List>
         auto& getEndpointInfo (const List& endpoints, EndpointHandle handle)
         {
@@ -451,6 +1188,30 @@ struct LLVMEngine
         }
     };
 
+    /// Attempts to re-create a fully-linked program from the cache, returning nullptr if
+    /// there's no suitable entry, in which case the normal compile and link must be done.
+    std::shared_ptr<LinkedCode> loadLinkedCodeFromCache (CacheDatabaseInterface& cache, const char* cacheKey, bool isSingleFrameOnly)
+    {
+        if (! engine.buildSettings.shouldCacheObjectCode() || engine.buildSettings.shouldInstrumentForProfiling())
+            return {};
+
+        LinkedCode::CachedObjectCode cachedObject;
+
+        if (! cachedObject.load (cache, LinkedCode::getObjectCacheKey (cacheKey).c_str()))
+            return {};
+
+        // Programs with host functions need the AST to find them, so must take the normal path
+        if (! cachedObject.linkInfo.isObject() || cachedObject.linkInfo.hasObjectMember ("externalFunctions"))
+            return {};
+
+        try
+        {
+            return std::make_shared<LinkedCode> (*this, isSingleFrameOnly, std::move (cachedObject));
+        }
+        catch (...) {}
+
+        return {};
+    }
 
     //==============================================================================
     struct JITInstance
@@ -465,7 +1226,9 @@ struct LLVMEngine
 
             advanceOneFrameFn = code->advanceOneFrameFn;
             advanceBlockFn = code->advanceBlockFn;
+            advanceToFrameFn = code->advanceToFrameFn;
 
+            initialState = code->getInitialState (sessionID, frequency);
             reset();
         }
 
@@ -474,25 +1237,65 @@ struct LLVMEngine
         choc::AlignedMemoryBlock<LinkedCode::alignmentBytes> stateMemory, ioMemory;
 
         AdvanceOneFrameFn advanceOneFrameFn = {};
-        AdvanceBlockFn    advanceBlockFn = {};
+        AdvanceBlockFn    advanceBlockFn = {}, advanceToFrameFn = {};
 
         uint8_t* statePointer = nullptr;
         uint8_t* ioPointer = nullptr;
         const int sessionID;
         const double frequency;
+        std::shared_ptr<const LinkedCode::InitialState> initialState;
 
         //==============================================================================
         Result reset() noexcept
         {
-            stateMemory.clear();
             ioMemory.clear();
 
+            if (initialState != nullptr)
+            {
+                memcpy (statePointer, initialState->state.data(), code->stateSize);
+                return Result::Ok;
+            }
+
+            stateMemory.clear();
+
             int processorID = 0;
             code->initialiseFn (statePointer, &processorID, sessionID, frequency);
 
             return Result::Ok;
         }
 
+        uint64_t getStateSize() const noexcept
+        {
+            return code->stateCanBeCopied ? code->stateSize : 0;
+        }
+
+        Result copyState (void* dest) const noexcept
+        {
+            if (! code->stateCanBeCopied)
+                return Result::InvalidState;
+
+            memcpy (dest, statePointer, code->stateSize);
+            return Result::Ok;
+        }
+
+        const char* getStateLayout() const noexcept
+        {
+            if (! code->stateCanBeCopied)
+                return nullptr;
+
+            auto& json = code->getStateLayoutJSON();
+            return json.empty() ? nullptr : json.c_str();
+        }
+
+        Result setState (const void* source, uint64_t size) noexcept
+        {
+            if (! code->stateCanBeCopied || size != code->stateSize)
+                return Result::InvalidState;
+
+            memcpy (statePointer, source, code->stateSize);
+            return Result::Ok;
+        }
+
         void advance (uint32_t framesToAdvance) noexcept
         {
             if (advanceOneFrameFn)
@@ -501,6 +1304,18 @@ struct LLVMEngine
                 advanceBlockFn (statePointer, ioPointer, framesToAdvance);
         }
 
+        bool canAdvanceToFrame() const noexcept
+        {
+            return advanceToFrameFn != nullptr;
+        }
+
+        /// Renders up to (but not including) the given frame of the current block, so that an
+        /// event can be delivered there. The rest of the block is rendered by advance().
+        void advanceToFrame (uint32_t frame) noexcept
+        {
+            advanceToFrameFn (statePointer, ioPointer, frame);
+        }
+
         std::function<Result(void*, uint32_t)> createCopyOutputValueFunction (const EndpointInfo& e)
         {
             if (e.details.isStream())
@@ -554,6 +1369,24 @@ struct LLVMEngine
             }
         }
 
+        void* getStreamBuffer (const EndpointInfo& e, uint32_t& frameStride)
+        {
+            auto getBuffer = [&] (auto& info) -> void*
+            {
+                // if the native frame layout needs repacking, the caller can't use it directly
+                if (info.frameSize != info.frameStride)
+                    return nullptr;
+
+                frameStride = static_cast<uint32_t> (info.frameStride);
+                return ioPointer + info.addressOffset;
+            };
+
+            if (e.details.isInput)
+                return getBuffer (code->getEndpointInfo (code->inputStreams, e.handle));
+
+            return getBuffer (code->getEndpointInfo (code->outputStreams, e.handle));
+        }
+
         std::function<void(const void*, uint32_t, uint32_t)> createSetInputStreamFramesFunction (const EndpointInfo& e)
         {
             auto& info = code->getEndpointInfo (code->inputStreams, e.handle);
@@ -567,7 +1400,9 @@ struct LLVMEngine
                 {
                     auto source = static_cast<const uint8_t*> (sourceData);
                     auto size = destStride * numFrames;
-                    memcpy (dest, source, size);
+
+                    if (size != 0)
+                        memcpy (dest, source, size);
 
                     if (numTrailingFramesToClear != 0)
                         memset (dest + size, 0, numTrailingFramesToClear * destStride);
@@ -611,24 +1446,35 @@ struct LLVMEngine
             };
         }
 
-        std::function<void(const void*)> createSendEventFunction (const EndpointInfo&, const AST::TypeBase& type, const AST::Function& f)
+        std::function<void(const void*)> createSendEventFunction (const EndpointInfo& e, uint32_t typeIndex, const AST::TypeBase&)
         {
-            auto eventType = type.toChocType();
-            auto name = AST::getEventHandlerFunctionName (f);
+            auto& info = code->getEndpointInfo (code->inputEvents, e.handle);
+            CMAJ_ASSERT (typeIndex < info.eventTypeHandlers.size());
+            auto& handler = info.eventTypeHandlers[typeIndex];
+
+            if (handler.functionName.empty())
+                return {};
+
             auto state = statePointer;
 
-            void* call = code->lljit.findSymbol (name);
+            void* call = code->lljit.findSymbol (handler.functionName);
             CMAJ_ASSERT (call != nullptr);
 
-            if (type.isVoid())              return [call, state] (const void*)      { using F = void(*)(void*);           reinterpret_cast<F> (call) (state); };
-            if (type.isPrimitiveInt32())    return [call, state] (const void* data) { using F = void(*)(void*, int32_t);  reinterpret_cast<F> (call) (state, *static_cast<const int32_t*>  (data)); };
-            if (type.isPrimitiveInt64())    return [call, state] (const void* data) { using F = void(*)(void*, int64_t);  reinterpret_cast<F> (call) (state, *static_cast<const int64_t*>  (data)); };
-            if (type.isPrimitiveFloat32())  return [call, state] (const void* data) { using F = void(*)(void*, float);    reinterpret_cast<F> (call) (state, *static_cast<const float*>    (data)); };
-            if (type.isPrimitiveFloat64())  return [call, state] (const void* data) { using F = void(*)(void*, double);   reinterpret_cast<F> (call) (state, *static_cast<const double*>   (data)); };
-            if (type.isPrimitiveBool())     return [call, state] (const void* data) { using F = void(*)(void*, int32_t);  reinterpret_cast<F> (call) (state, *static_cast<const int32_t*>  (data)); };
-            if (type.isPrimitiveString())   return [call, state] (const void* data) { using F = void(*)(void*, uint32_t); reinterpret_cast<F> (call) (state, *static_cast<const uint32_t*> (data)); };
+            using ArgumentType = LinkedCode::InputEventEndpoint::ArgumentType;
 
-            auto& layout = *code->nativeTypeLayouts.find (type);
+            switch (handler.argumentType)
+            {
+                case ArgumentType::none:          return [call, state] (const void*)      { using F = void(*)(void*);           reinterpret_cast<F> (call) (state); };
+                case ArgumentType::int32:         return [call, state] (const void* data) { using F = void(*)(void*, int32_t);  reinterpret_cast<F> (call) (state, *static_cast<const int32_t*>  (data)); };
+                case ArgumentType::int64:         return [call, state] (const void* data) { using F = void(*)(void*, int64_t);  reinterpret_cast<F> (call) (state, *static_cast<const int64_t*>  (data)); };
+                case ArgumentType::float32:       return [call, state] (const void* data) { using F = void(*)(void*, float);    reinterpret_cast<F> (call) (state, *static_cast<const float*>    (data)); };
+                case ArgumentType::float64:       return [call, state] (const void* data) { using F = void(*)(void*, double);   reinterpret_cast<F> (call) (state, *static_cast<const double*>   (data)); };
+                case ArgumentType::stringHandle:  return [call, state] (const void* data) { using F = void(*)(void*, uint32_t); reinterpret_cast<F> (call) (state, *static_cast<const uint32_t*> (data)); };
+                case ArgumentType::pointer:
+                default:                          break;
+            }
+
+            auto& layout = *handler.layout;
 
             if (layout.requiresPacking())
             {
@@ -701,9 +1547,9 @@ struct LLVMEngine
         choc::value::StringDictionary& getDictionary()  { return code->stringDictionary; }
     };
 
-    PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code)
+    PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code, uint32_t numInstances)
     {
-        return choc::com::create<PerformerBase<JITInstance>> (code, engine)
+        return choc::com::create<PerformerBase<JITInstance>> (code, engine, numInstances)
                  .getWithIncrementedRefCount();
     }
 };
@@ -776,6 +1622,8 @@ std::string generateAssembler (const cmaj::ProgramInterface& p,
                                  stringDictionary,
                                  false);
 
+    generator.optimisationTarget = targetMachine.get();
+
     if (generator.generate())
         return generator.printAssembly (*targetMachine, targetFormat == "obj");
 
@@ -855,6 +1703,8 @@ webassembly::WebAssemblyModule generateWebAssembly (const ProgramInterface& p, c
                                                           m.stringDictionary,
                                                           true);
 
+    generator->optimisationTarget = targetMachine.get();
+
     if (generator->generate())
     {
         m.binaryWASMData = generator->printAssembly (*targetMachine, ! createWAST);
@@ -0,0 +1,243 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+namespace cmaj::llvm
+{
+
+//==============================================================================
+/// Emits inline polynomial versions of sin, cos, exp, log, log10 and pow which work
+/// on all the lanes of a float vector at once. Without these, LLVM splits a call to one
+/// of its maths intrinsics on a vector into a separate libm call for each lane.
+///
+/// The range reductions and polynomials are the single-precision ones from Cephes.
+/// If evaluateInFloat64 is set, float32 lanes are widened to float64 while the kernel
+/// runs, which keeps the results within about 1 ulp of the correctly rounded value.
+/// Otherwise the kernel runs in the lane type. That's quicker, but float32 results can
+/// be a few ulp out, and float64 results only have float32-grade accuracy.
+struct LLVMVectorMaths
+{
+    LLVMVectorMaths (::llvm::IRBuilder<>& builder, ::llvm::Module& m, ::llvm::Type* vectorType, bool evaluateInFloat64)
+        : b (builder), module (m), originalType (vectorType)
+    {
+        auto numLanes = ::llvm::cast<::llvm::FixedVectorType> (vectorType)->getNumElements();
+        auto& context = vectorType->getContext();
+
+        isDouble = evaluateInFloat64 || vectorType->getScalarType()->isDoubleTy();
+
+        floatType = ::llvm::FixedVectorType::get (isDouble ? ::llvm::Type::getDoubleTy (context)
+                                                           : ::llvm::Type::getFloatTy (context), numLanes);
+        intType   = ::llvm::FixedVectorType::get (isDouble ? ::llvm::Type::getInt64Ty (context)
+                                                           : ::llvm::Type::getInt32Ty (context), numLanes);
+    }
+
+    ::llvm::Value* sin (::llvm::Value* x)                       { return narrow (sinOrCos (widen (x), false)); }
+    ::llvm::Value* cos (::llvm::Value* x)                       { return narrow (sinOrCos (widen (x), true)); }
+    ::llvm::Value* exp (::llvm::Value* x)                       { return narrow (expKernel (widen (x))); }
+    ::llvm::Value* log (::llvm::Value* x)                       { return narrow (logKernel (widen (x))); }
+    ::llvm::Value* log10 (::llvm::Value* x)                     { return narrow (b.CreateFMul (logKernel (widen (x)), constant (0.43429448190325182765))); }
+    ::llvm::Value* pow (::llvm::Value* x, ::llvm::Value* y)     { return narrow (powKernel (widen (x), widen (y))); }
+
+private:
+    ::llvm::IRBuilder<>& b;
+    ::llvm::Module& module;
+    ::llvm::Type* originalType;
+    ::llvm::Type* floatType;
+    ::llvm::Type* intType;
+    bool isDouble;
+
+    int64_t getMantissaBits() const     { return isDouble ? 52 : 23; }
+    int64_t getExponentBias() const     { return isDouble ? 1023 : 127; }
+
+    ::llvm::Value* widen (::llvm::Value* v)     { return v->getType() == floatType ? v : b.CreateFPExt (v, floatType); }
+    ::llvm::Value* narrow (::llvm::Value* v)    { return v->getType() == originalType ? v : b.CreateFPTrunc (v, originalType); }
+
+    ::llvm::Constant* constant (double v)       { return ::llvm::ConstantFP::get (floatType, v); }
+    ::llvm::Constant* intConstant (int64_t v)   { return ::llvm::ConstantInt::get (intType, static_cast<uint64_t> (v), true); }
+
+    ::llvm::Value* callIntrinsic (::llvm::Intrinsic::ID intrinsicID, ::llvm::Value* x)
+    {
+        ::llvm::Type* overloads[] = { x->getType() };
+        return b.CreateCall (::llvm::Intrinsic::getDeclaration (std::addressof (module), intrinsicID, overloads), { x });
+    }
+
+    ::llvm::Value* callIntrinsic (::llvm::Intrinsic::ID intrinsicID, ::llvm::Value* x, ::llvm::Value* y)
+    {
+        ::llvm::Type* overloads[] = { x->getType() };
+        return b.CreateCall (::llvm::Intrinsic::getDeclaration (std::addressof (module), intrinsicID, overloads), { x, y });
+    }
+
+    // Saturating, so that NaNs and huge values give a harmless lane rather than poison
+    ::llvm::Value* toInt (::llvm::Value* x)
+    {
+        ::llvm::Type* overloads[] = { intType, floatType };
+        return b.CreateCall (::llvm::Intrinsic::getDeclaration (std::addressof (module), ::llvm::Intrinsic::fptosi_sat, overloads), { x });
+    }
+
+    ::llvm::Value* isBitSet (::llvm::Value* n, int64_t bit)
+    {
+        return b.CreateICmpNE (b.CreateAnd (n, intConstant (bit)), intConstant (0));
+    }
+
+    // Returns 2^n for n within the normal exponent range
+    ::llvm::Value* powerOfTwo (::llvm::Value* n)
+    {
+        return b.CreateBitCast (b.CreateShl (b.CreateAdd (n, intConstant (getExponentBias())), intConstant (getMantissaBits())), floatType);
+    }
+
+    // Evaluates the polynomial with the given coefficients, highest power first
+    ::llvm::Value* polynomial (::llvm::Value* x, std::initializer_list<double> coefficients)
+    {
+        auto c = coefficients.begin();
+        ::llvm::Value* result = constant (*c);
+
+        while (++c != coefficients.end())
+            result = b.CreateFAdd (b.CreateFMul (result, x), constant (*c));
+
+        return result;
+    }
+
+    //==============================================================================
+    ::llvm::Value* sinOrCos (::llvm::Value* x, bool isCos)
+    {
+        auto quadrant = callIntrinsic (::llvm::Intrinsic::rint, b.CreateFMul (x, constant (0.63661977236758134308)));
+
+        // Subtract quadrant * pi/2 in parts that multiply exactly, to keep the low bits of x
+        auto r = x;
+
+        for (auto part : isDouble ? std::initializer_list<double> { 1.57079632673412561417e+00, 6.07710050650619224932e-11 }
+                                  : std::initializer_list<double> { 1.5703125, 4.837512969970703125e-4, 7.54978995489188216e-8 })
+            r = b.CreateFSub (r, b.CreateFMul (quadrant, constant (part)));
+
+        auto z = b.CreateFMul (r, r);
+
+        auto sinR = b.CreateFAdd (r, b.CreateFMul (b.CreateFMul (r, z),
+                                                   polynomial (z, { -1.9515295891e-4, 8.3321608736e-3, -1.6666654611e-1 })));
+
+        auto cosR = b.CreateFAdd (b.CreateFSub (constant (1.0), b.CreateFMul (z, constant (0.5))),
+                                  b.CreateFMul (b.CreateFMul (z, z),
+                                                polynomial (z, { 2.443315711809948e-5, -1.388731625493765e-3, 4.166664568298827e-2 })));
+
+        auto n = toInt (quadrant);
+
+        if (isCos)
+            n = b.CreateAdd (n, intConstant (1));
+
+        auto result = b.CreateSelect (isBitSet (n, 1), cosR, sinR);
+        result = b.CreateSelect (isBitSet (n, 2), b.CreateFNeg (result), result);
+
+        // The sum above loses the sign of a zero, which sin() must keep
+        if (! isCos)
+            result = b.CreateSelect (b.CreateFCmpOEQ (x, constant (0.0)), x, result);
+
+        return result;
+    }
+
+    ::llvm::Value* expKernel (::llvm::Value* x)
+    {
+        auto n = callIntrinsic (::llvm::Intrinsic::rint, b.CreateFMul (x, constant (1.44269504088896341)));
+        auto r = b.CreateFSub (b.CreateFSub (x, b.CreateFMul (n, constant (0.693359375))),
+                               b.CreateFMul (n, constant (-2.121944400546905827679e-4)));
+
+        auto p = polynomial (r, { 1.9875691500e-4, 1.3981999507e-3, 8.3334519073e-3,
+                                  4.1665795894e-2, 1.6666665459e-1, 5.0000001201e-1 });
+
+        p = b.CreateFAdd (b.CreateFAdd (b.CreateFMul (p, b.CreateFMul (r, r)), r), constant (1.0));
+
+        // Scaling in two steps lets results near the ends of the range (including denormals)
+        // round correctly without the exponent field overflowing
+        auto ni = toInt (n);
+        auto n1 = b.CreateAShr (ni, intConstant (1));
+        auto n2 = b.CreateSub (ni, n1);
+        p = b.CreateFMul (b.CreateFMul (p, powerOfTwo (n1)), powerOfTwo (n2));
+
+        auto maxLog = isDouble ? 709.782712893383973096 : 88.72283905206835;
+        auto minLog = isDouble ? -745.13321910194110842 : -103.97207708;
+
+        p = b.CreateSelect (b.CreateFCmpOGT (x, constant (maxLog)), ::llvm::ConstantFP::getInfinity (floatType), p);
+        return b.CreateSelect (b.CreateFCmpOLT (x, constant (minLog)), constant (0.0), p);
+    }
+
+    ::llvm::Value* logKernel (::llvm::Value* x)
+    {
+        auto mantissaBits = getMantissaBits();
+        auto bias = getExponentBias();
+
+        // Denormals are scaled up into the normal range so that the exponent can be read from the bits
+        auto denormalScaleBits = mantissaBits + 2;
+        auto isDenormal = b.CreateFCmpOLT (x, constant (isDouble ? 2.2250738585072014e-308 : 1.17549435e-38));
+        auto scaled = b.CreateSelect (isDenormal, b.CreateFMul (x, constant (std::ldexp (1.0, static_cast<int> (denormalScaleBits)))), x);
+
+        auto bits = b.CreateBitCast (scaled, intType);
+        auto exponent = b.CreateSub (b.CreateAnd (b.CreateLShr (bits, intConstant (mantissaBits)), intConstant (isDouble ? 0x7ff : 0xff)),
+                                     intConstant (bias - 1));
+        exponent = b.CreateSelect (isDenormal, b.CreateSub (exponent, intConstant (denormalScaleBits)), exponent);
+
+        // m is in the range 0.5 to 1
+        auto m = b.CreateBitCast (b.CreateOr (b.CreateAnd (bits, intConstant ((int64_t (1) << mantissaBits) - 1)),
+                                              intConstant ((bias - 1) << mantissaBits)), floatType);
+
+        auto isBelowRootHalf = b.CreateFCmpOLT (m, constant (0.707106781186547524));
+        exponent = b.CreateSelect (isBelowRootHalf, b.CreateSub (exponent, intConstant (1)), exponent);
+        m = b.CreateFSub (b.CreateSelect (isBelowRootHalf, b.CreateFAdd (m, m), m), constant (1.0));
+
+        auto e = b.CreateSIToFP (exponent, floatType);
+        auto z = b.CreateFMul (m, m);
+
+        auto y = b.CreateFMul (b.CreateFMul (polynomial (m, { 7.0376836292e-2, -1.1514610310e-1, 1.1676998740e-1,
+                                                              -1.2420140846e-1, 1.4249322787e-1, -1.6668057665e-1,
+                                                              2.0000714765e-1, -2.4999993993e-1, 3.3333331174e-1 }), m), z);
+
+        y = b.CreateFAdd (y, b.CreateFMul (e, constant (-2.121944400546905827679e-4)));
+        y = b.CreateFSub (y, b.CreateFMul (z, constant (0.5)));
+
+        auto result = b.CreateFAdd (b.CreateFAdd (m, y), b.CreateFMul (e, constant (0.693359375)));
+
+        result = b.CreateSelect (b.CreateFCmpOEQ (x, constant (0.0)), ::llvm::ConstantFP::getInfinity (floatType, true), result);
+        result = b.CreateSelect (b.CreateFCmpOLT (x, constant (0.0)), ::llvm::ConstantFP::getNaN (floatType), result);
+        result = b.CreateSelect (b.CreateFCmpOEQ (x, ::llvm::ConstantFP::getInfinity (floatType)), x, result);
+        return b.CreateSelect (b.CreateFCmpUNO (x, x), x, result);
+    }
+
+    ::llvm::Value* powKernel (::llvm::Value* x, ::llvm::Value* y)
+    {
+        auto result = expKernel (b.CreateFMul (y, logKernel (callIntrinsic (::llvm::Intrinsic::fabs, x))));
+        auto infinity = ::llvm::ConstantFP::getInfinity (floatType);
+
+        // An odd integer power takes the sign of the base (including -0), and a negative finite
+        // base has no real result for a power that isn't an integer
+        auto halfY = b.CreateFMul (y, constant (0.5));
+        auto isInteger = b.CreateFCmpOEQ (callIntrinsic (::llvm::Intrinsic::rint, y), y);
+        auto isOdd = b.CreateAnd (isInteger, b.CreateFCmpONE (callIntrinsic (::llvm::Intrinsic::floor, halfY), halfY));
+        result = b.CreateSelect (isOdd, callIntrinsic (::llvm::Intrinsic::copysign, result, x), result);
+
+        auto isNegativeFinite = b.CreateAnd (b.CreateFCmpOLT (x, constant (0.0)),
+                                             b.CreateFCmpOGT (x, ::llvm::ConstantFP::getInfinity (floatType, true)));
+        result = b.CreateSelect (b.CreateAnd (isNegativeFinite, b.CreateNot (isInteger)), ::llvm::ConstantFP::getNaN (floatType), result);
+
+        // These are 1 even when the log and exp would give a NaN
+        auto isMinusOneToInfinity = b.CreateAnd (b.CreateFCmpOEQ (x, constant (-1.0)),
+                                                 b.CreateFCmpOEQ (callIntrinsic (::llvm::Intrinsic::fabs, y), infinity));
+        result = b.CreateSelect (isMinusOneToInfinity, constant (1.0), result);
+        result = b.CreateSelect (b.CreateFCmpOEQ (x, constant (1.0)), constant (1.0), result);
+        return b.CreateSelect (b.CreateFCmpOEQ (y, constant (0.0)), constant (1.0), result);
+    }
+};
+
+}
@@ -55,6 +55,7 @@ struct WebAssemblyEngine
     static constexpr bool usesDynamicRateAndSessionID = false;
     static constexpr bool allowTopLevelSlices = false;
     static constexpr bool supportsExternalFunctions = false;
+    static constexpr bool canLinkFromCachedCode = false;
     static bool engineSupportsIntrinsic (AST::Intrinsic::Type) { return false; }
 
     //==============================================================================
@@ -153,6 +154,18 @@ initialisePatch();
             return Result::Ok;
         }
 
+        // The state lives inside the javascript context, so can't be copied directly
+        uint64_t getStateSize() const                       { return 0; }
+        Result copyState (void*) const                      { return Result::InvalidState; }
+        const char* getStateLayout() const                  { return nullptr; }
+        Result setState (const void*, uint64_t) const       { return Result::InvalidState; }
+
+        // The IO buffers live inside the javascript context's memory, which may be moved
+        void* getStreamBuffer (const EndpointInfo&, uint32_t&)  { return nullptr; }
+
+        bool canAdvanceToFrame() const                          { return false; }
+        void advanceToFrame (uint32_t)                          {}
+
         void advance (uint32_t framesToAdvance)
         {
             ScopedDisableAllocationTracking disableTracking;
@@ -306,10 +319,15 @@ initialisePatch();
             };
         }
 
-        std::function<void(const void*)> createSendEventFunction (const EndpointInfo&, const AST::TypeBase& type, const AST::Function& f)
+        std::function<void(const void*)> createSendEventFunction (const EndpointInfo& e, uint32_t, const AST::TypeBase& type)
         {
+            auto f = AST::findEventHandlerFunction (e.endpoint, type);
+
+            if (f == nullptr)
+                return {};
+
             auto eventType = type.toChocType();
-            auto command = instanceName + "." + AST::getEventHandlerFunctionName (f, "sendInputEvent_") + "(";
+            auto command = instanceName + "." + AST::getEventHandlerFunctionName (*f, "sendInputEvent_") + "(";
             auto temp = choc::value::Value (eventType);
 
             return [this, command, t = std::move (temp)] (const void* eventData) mutable
@@ -527,9 +545,9 @@ initialisePatch();
 
 
     //==============================================================================
-    PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code)
+    PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code, uint32_t numInstances)
     {
-        return choc::com::create<PerformerBase<JITInstance>> (code, engine)
+        return choc::com::create<PerformerBase<JITInstance>> (code, engine, numInstances)
                  .getWithIncrementedRefCount();
     }
 
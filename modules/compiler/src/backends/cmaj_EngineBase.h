@@ -27,6 +27,7 @@
 #include "CPlusPlus/cmaj_CPlusPlus.h"
 #include "WebAssembly/cmaj_WebAssembly.h"
 #include "LLVM/cmaj_LLVM.h"
+#include "cmaj_RenderThreadPool.h"
 
 namespace cmaj
 {
@@ -57,7 +58,7 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
 
     //==============================================================================
     choc::value::Value options;
-    BuildSettings buildSettings;
+    BuildSettings buildSettings, linkedBuildSettings;
     std::unique_ptr<Implementation> implementation;
     ptr<AST::ProcessorBase> mainProcessor;
     ptr<AST::Program> program;
@@ -162,13 +163,16 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
             newProgram->externalVariableManager.setExternalRequestor (requestExternalVariable, variableContext);
             newProgram->externalFunctionManager.setExternalRequestor (requestExternalFunction, functionContext);
 
-            transformations::runBasicResolutionPasses (*newProgram);
+            transformations::runBasicResolutionPasses (*newProgram, buildSettings.shouldUseFullResolutionPasses());
             newProgram->setMainProcessor (*newProgram->findMainProcessorCandidate (buildSettings.getMainProcessor()));
             mainProcessor = newProgram->findMainProcessor();
 
-            transformations::prepareForResolution (*newProgram, buildSettings.getMaxStackSize());
+            transformations::prepareForResolution (*newProgram, buildSettings.getMaxStackSize(), buildSettings.shouldUseFullResolutionPasses());
 
-            newProgram->endpointList.initialise (*mainProcessor);
+            newProgram->endpointList.initialise (*mainProcessor, [this] (const EndpointID& e)
+            {
+                return buildSettings.isEndpointFrozen (e.toString());
+            });
 
             program = newProgram;
             programToLoad->addRef();
@@ -191,7 +195,31 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
             if (! isLoaded())
                 throwError (Errors::noProgramLoaded());
 
+            for (auto& e : endpointHandles)
+                if (buildSettings.isEndpointFrozen (e.details.endpointID.toString()))
+                    throwError (Errors::cannotFreezeEndpointInUse (e.details.endpointID.toString()));
+
             double latency = 0;
+            bool isSingleFrameOnly = buildSettings.getMaxBlockSize() == 1;
+            std::string cacheKey;
+
+            if (cache != nullptr)
+            {
+                cacheKey = getCacheKey (*cache);
+
+                if constexpr (Implementation::canLinkFromCachedCode)
+                {
+                    auto pc = compilePerformanceTimes.getCounter ("link");
+
+                    // If the cache holds a fully-linked image for this program, there's no need
+                    // to run any of the code-gen transformations at all
+                    if ((linkedCode = implementation->loadLinkedCodeFromCache (*cache, cacheKey.c_str(), isSingleFrameOnly)))
+                    {
+                        linkedBuildSettings = buildSettings;
+                        return;
+                    }
+                }
+            }
 
             {
                 auto pc = compilePerformanceTimes.getCounter ("compile");
@@ -199,7 +227,7 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
                 transformations::prepareForCodeGen (*program,
                                                     buildSettings,
                                                     Implementation::canUseForwardBranches,
-                                                    Implementation::usesDynamicRateAndSessionID,
+                                                    usesDynamicRate(),
                                                     Implementation::allowTopLevelSlices,
                                                     Implementation::supportsExternalFunctions,
                                                     Implementation::engineSupportsIntrinsic,
@@ -210,28 +238,80 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
             {
                 auto pc = compilePerformanceTimes.getCounter ("link");
 
-                std::string cacheKey;
-
-                if (cache != nullptr)
-                    cacheKey = getCacheKey();
-
-                bool isSingleFrameOnly = buildSettings.getMaxBlockSize() == 1;
                 linkedCode = std::make_shared<typename Implementation::LinkedCode> (*implementation, isSingleFrameOnly,
                                                                                     latency, cache, cacheKey.c_str());
             }
+
+            linkedBuildSettings = buildSettings;
         });
     }
 
+    /// True if the frequency is read from the state rather than compiled into the code, in
+    /// which case a linked program can be used to create performers at any frequency.
+    bool usesDynamicRate() const
+    {
+        return Implementation::usesDynamicRateAndSessionID || buildSettings.shouldUseDynamicRate();
+    }
+
     choc::com::String* getLastBuildLog() override
     {
         return choc::com::createRawString (compilePerformanceTimes.getResults());
     }
 
-    std::string getCacheKey()
+    /// If the build uses profile data, the profile currently in the cache is part of the key,
+    /// so that code which was optimised using an older profile isn't reused.
+    std::string getCacheKey (CacheDatabaseInterface& cache)
+    {
+        std::vector<uint8_t> profile;
+
+        if (buildSettings.shouldUseProfileData())
+        {
+            auto profileKey = getProfileCacheKey();
+
+            if (auto size = cache.reload (profileKey.c_str(), nullptr, 0))
+            {
+                profile.resize (static_cast<size_t> (size));
+
+                if (cache.reload (profileKey.c_str(), profile.data(), size) != size)
+                    profile.clear();
+            }
+        }
+
+        return getCacheKey (getSettingsToHash (buildSettings), profile);
+    }
+
+    /// The key under which an instrumented build stores its profile counts, and from which
+    /// a build that uses profile data reads them.
+    std::string getProfileCacheKey()
+    {
+        return getCacheKey (getSettingsToHash (buildSettings.withoutProfilingSettings())) + "_profile";
+    }
+
+    /// Clears any settings which don't affect the generated code, so that builds which
+    /// only differ in those can share a cache entry.
+    BuildSettings getSettingsToHash (BuildSettings settings) const
+    {
+        settings.setSessionID (0);
+
+        if (usesDynamicRate())
+            settings.setFrequency (0);
+
+        return settings;
+    }
+
+    std::string getCacheKey (const BuildSettings& settingsToHash, const std::vector<uint8_t>& profileData = {})
     {
         auto hash = getProgram().codeHash;
         hash.addInput (implementation->getEngineVersion());
-        hash.addInput (BuildSettings (buildSettings).setSessionID (0).toJSON());
+        hash.addInput (settingsToHash.toJSON());
+
+        if (! profileData.empty())
+            hash.addInput (profileData.data(), profileData.size());
+
+        for (auto& e : endpointHandles)
+            hash.addInput (e.details.endpointID.toString());
+
+        getProgram().externalVariableManager.addToHash (hash);
 
         return std::string (mainProcessor->getName()) + "_" + choc::text::createHexString (hash.getHash());
     }
@@ -287,7 +367,15 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
     PerformerInterface* createPerformer() override
     {
         if (linkedCode != nullptr)
-            return implementation->createPerformer (linkedCode);
+            return implementation->createPerformer (linkedCode, 1);
+
+        return {};
+    }
+
+    PerformerInterface* createMultiInstancePerformer (uint32_t numInstances) override
+    {
+        if (linkedCode != nullptr && numInstances != 0)
+            return implementation->createPerformer (linkedCode, numInstances);
 
         return {};
     }
@@ -433,12 +521,23 @@ template <typename JITInstance>
 struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::PerformerInterface, PerformerBase<JITInstance>>
 {
     template <typename EngineType, typename LinkedCode>
-    PerformerBase (std::shared_ptr<LinkedCode> linkedCode, const EngineType& engine)
-        : jit (linkedCode, engine.buildSettings.getSessionID(), engine.buildSettings.getFrequency()),
-          maxBlockSize (engine.buildSettings.getMaxBlockSize()),
-          eventBufferSize (engine.buildSettings.getEventBufferSize()),
+    PerformerBase (std::shared_ptr<LinkedCode> linkedCode, const EngineType& engine, uint32_t numInstances = 1)
+        : maxBlockSize (engine.linkedBuildSettings.getMaxBlockSize()),
+          eventBufferSize (engine.linkedBuildSettings.getEventBufferSize()),
           latency (linkedCode->latency)
     {
+        CMAJ_ASSERT (numInstances != 0);
+
+        for (uint32_t i = 0; i < numInstances; ++i)
+            instances.push_back (std::make_unique<JITInstance> (linkedCode, engine.buildSettings.getSessionID(),
+                                                                engine.buildSettings.getFrequency()));
+
+        // The instances have independent state, so each one can be rendered on a different thread
+        auto numRenderThreads = std::min (engine.buildSettings.getRenderThreads(), numInstances);
+
+        if (numRenderThreads > 1)
+            renderThreadPool = std::make_unique<RenderThreadPool> (numRenderThreads - 1);
+
         initialiseEndpointList (engine.endpointHandles);
     }
 
@@ -447,7 +546,14 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
     //==============================================================================
     Result reset() override
     {
-        return jit.reset();
+        numFramesInLastBlock = 0;
+        queuedEvents.clear();
+        queuedEventData.clear();
+
+        for (auto& jit : instances)
+            jit->reset();
+
+        return Result::Ok;
     }
 
     Result setBlockSize (uint32_t numFramesForNextBlock) override
@@ -483,6 +589,22 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
         return Result::InvalidEndpointHandle;
     }
 
+    Result addInputEventAtFrame (EndpointHandle handle, uint32_t typeIndex, const void* eventData, uint32_t frameOffset) override
+    {
+        if (auto* endpointHandler = getEndpointHandler (handle))
+        {
+            if (frameOffset == 0)
+                return endpointHandler->addInputEvent (typeIndex, eventData);
+
+            if (! supportsFrameOffsets())
+                return Result::FrameOffsetNotSupported;
+
+            return endpointHandler->queueInputEvent (typeIndex, eventData, frameOffset);
+        }
+
+        return Result::InvalidEndpointHandle;
+    }
+
     Result copyOutputValue (EndpointHandle handle, void* dest) override
     {
         if (auto* endpointHandler = getEndpointHandler (handle))
@@ -499,6 +621,14 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
         return Result::InvalidEndpointHandle;
     }
 
+    void* getStreamBuffer (EndpointHandle handle, uint32_t& frameStride) override
+    {
+        if (auto* endpointHandler = getEndpointHandler (handle))
+            return endpointHandler->getStreamBuffer (frameStride);
+
+        return nullptr;
+    }
+
     Result iterateOutputEvents (EndpointHandle handle, void* context, PerformerInterface::HandleOutputEventCallback handler) override
     {
         if (auto* endpointHandler = getEndpointHandler (handle))
@@ -509,7 +639,24 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
 
     Result advance() override
     {
-        jit.advance (numFramesToDo);
+        for (auto& s : outputStreamHandlers)
+            s->clearDirectBuffer (numFramesInLastBlock);
+
+        if (! queuedEvents.empty())
+            dispatchQueuedEvents();
+
+        if (renderThreadPool != nullptr)
+        {
+            auto advanceInstance = [this] (uint32_t i) { instances[i]->advance (numFramesToDo); };
+            renderThreadPool->run (static_cast<uint32_t> (instances.size()), advanceInstance);
+        }
+        else
+        {
+            for (auto& jit : instances)
+                jit->advance (numFramesToDo);
+        }
+
+        numFramesInLastBlock = numFramesToDo;
 
         for (auto& e : outputEventHandlers)
             e->moveOutputEventsToQueue();
@@ -517,17 +664,122 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
         return Result::Ok;
     }
 
+    Result setBlockBindings (const EndpointHandle* inputs, uint32_t numInputs,
+                             const EndpointHandle* outputs, uint32_t numOutputs) override
+    {
+        std::vector<EndpointHandler*> newInputs, newOutputs;
+
+        for (uint32_t i = 0; i < numInputs; ++i)
+        {
+            auto* endpointHandler = getEndpointHandler (inputs[i]);
+
+            if (endpointHandler == nullptr || ! endpointHandler->canBeBoundAsInput)
+                return Result::InvalidEndpointHandle;
+
+            newInputs.push_back (endpointHandler);
+        }
+
+        for (uint32_t i = 0; i < numOutputs; ++i)
+        {
+            auto* endpointHandler = getEndpointHandler (outputs[i]);
+
+            if (endpointHandler == nullptr || ! endpointHandler->canBeBoundAsOutput)
+                return Result::InvalidEndpointHandle;
+
+            newOutputs.push_back (endpointHandler);
+        }
+
+        inputBindings = std::move (newInputs);
+        outputBindings = std::move (newOutputs);
+        return Result::Ok;
+    }
+
+    Result processBlock (uint32_t numFrames, const void* const* inputData, void* const* outputData) override
+    {
+        if (numFrames == 0 || numFrames > maxBlockSize)
+            return Result::InvalidBlockSize;
+
+        numFramesToDo = numFrames;
+
+        for (size_t i = 0; i < inputBindings.size(); ++i)
+            inputBindings[i]->setBlockInput (inputData[i], numFrames);
+
+        advance();
+
+        for (size_t i = 0; i < outputBindings.size(); ++i)
+            if (auto* dest = outputData[i])
+                outputBindings[i]->copyBlockOutput (dest, numFrames);
+
+        return Result::Ok;
+    }
+
     uint32_t getMaximumBlockSize() override     { return maxBlockSize; }
     double getLatency() override                { return latency; }
     uint32_t getEventBufferSize() override      { return eventBufferSize; }
+    bool supportsFrameOffsets() override        { return instances.front()->canAdvanceToFrame(); }
     uint32_t getXRuns() override                { return xruns; }
     const char* getRuntimeError() override      { return {}; }
 
+    EndpointHandle getEndpointHandleForInstance (EndpointHandle handle, uint32_t instanceIndex) override
+    {
+        if (handle < firstHandle || handle >= firstHandle + numHandlesPerInstance || instanceIndex >= instances.size())
+            return {};
+
+        return handle + instanceIndex * numHandlesPerInstance;
+    }
+
+    // The state of a multi-instance performer is the states of all its instances, one after the other
+    uint64_t getStateSize() override
+    {
+        return instances.front()->getStateSize() * instances.size();
+    }
+
+    Result copyState (void* dest) override
+    {
+        auto instanceSize = instances.front()->getStateSize();
+
+        for (auto& jit : instances)
+        {
+            if (auto r = jit->copyState (dest); r != Result::Ok)
+                return r;
+
+            dest = static_cast<uint8_t*> (dest) + instanceSize;
+        }
+
+        return Result::Ok;
+    }
+
+    Result setState (const void* source, uint64_t size) override
+    {
+        auto instanceSize = instances.front()->getStateSize();
+
+        if (size != instanceSize * instances.size())
+            return Result::InvalidState;
+
+        for (auto& jit : instances)
+        {
+            if (auto r = jit->setState (source, instanceSize); r != Result::Ok)
+                return r;
+
+            source = static_cast<const uint8_t*> (source) + instanceSize;
+        }
+
+        // any events queued for the rest of this block belong to the state being replaced
+        queuedEvents.clear();
+        queuedEventData.clear();
+        return Result::Ok;
+    }
+
+    const char* getStateLayout() override
+    {
+        return instances.front()->getStateLayout();
+    }
+
     const char* getStringForHandle (uint32_t handle, size_t& stringLength) override
     {
         try
         {
-            auto s = jit.getDictionary().getStringForHandle (choc::value::StringDictionary::Handle { handle });
+            auto s = instances.front()->getDictionary().getStringForHandle (choc::value::StringDictionary::Handle { handle });
             stringLength = s.length();
             return s.data();
         }
@@ -539,12 +791,68 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
 
     void registerXRun() { ++xruns; }
 
+    void queueEvent (JITInstance& jit, const std::function<void(const void*)>& handler, const void* data, uint32_t dataSize, uint32_t frame)
+    {
+        auto dataOffset = queuedEventData.size();
+        auto alignedSize = (dataSize + 7u) & ~7u;
+
+        // If the queue is full, the event is dropped, because allocating more space on the audio
+        // thread isn't allowed, and delivering it now would put it ahead of events already queued
+        if (queuedEvents.size() == queuedEvents.capacity() || dataOffset + alignedSize > queuedEventData.capacity())
+        {
+            registerXRun();
+            return;
+        }
+
+        queuedEventData.resize (dataOffset + alignedSize);
+
+        if (dataSize != 0)
+            memcpy (queuedEventData.data() + dataOffset, data, dataSize);
+
+        // keep the queue sorted by frame, with events for the same frame in the order they arrived
+        auto insertPos = std::upper_bound (queuedEvents.begin(), queuedEvents.end(), frame,
+                                           [] (uint32_t f, const QueuedEvent& e) { return f < e.frame; });
+
+        queuedEvents.insert (insertPos, { frame, std::addressof (jit), std::addressof (handler), dataOffset });
+    }
+
 private:
-    JITInstance jit;
+    std::vector<std::unique_ptr<JITInstance>> instances;
+    std::unique_ptr<RenderThreadPool> renderThreadPool;
 
     uint32_t numFramesToDo = 0,
+             numFramesInLastBlock = 0,
              xruns = 0;
 
+    struct QueuedEvent
+    {
+        uint32_t frame;
+        JITInstance* jit;
+        const std::function<void(const void*)>* handler;
+        size_t dataOffset;
+    };
+
+    std::vector<QueuedEvent> queuedEvents;
+    std::vector<uint8_t> queuedEventData;
+
+    void dispatchQueuedEvents()
+    {
+        // an event that's beyond the end of the block is delivered at its last frame, and if no
+        // block size has been set yet, they all go at the start
+        auto lastFrame = numFramesToDo != 0 ? numFramesToDo - 1 : 0;
+
+        for (auto& e : queuedEvents)
+        {
+            if (auto frame = std::min (e.frame, lastFrame); frame != 0)
+                e.jit->advanceToFrame (frame);
+
+            (*e.handler) (queuedEventData.data() + e.dataOffset);
+        }
+
+        queuedEvents.clear();
+        queuedEventData.clear();
+    }
+
     const uint32_t maxBlockSize, eventBufferSize;
     const double latency;
 
@@ -555,34 +863,57 @@ private:
             return;
 
         firstHandle = endpoints.front().handle;
+        numHandlesPerInstance = static_cast<uint32_t> (endpoints.size());
         lastHandle = firstHandle;
+        uint32_t maxEventDataSize = 0;
 
-        for (auto& endpoint : endpoints)
+        // Each instance gets its own block of handles, so instance N's handle for an endpoint
+        // is the engine's handle plus N * numHandlesPerInstance
+        for (uint32_t instanceIndex = 0; instanceIndex < instances.size(); ++instanceIndex)
         {
-            CMAJ_ASSERT (endpoint.handle == lastHandle); // handles must be in order
-            ++lastHandle;
+            auto& jit = instances[instanceIndex];
 
-            if (endpoint.details.isInput)
+            for (auto& endpoint : endpoints)
             {
-                if (endpoint.details.isEvent())
-                    endpointHandlers.push_back (std::make_unique<InputEventHandler> (*this, endpoint));
-                else if (endpoint.details.isStream())
-                    endpointHandlers.push_back (std::make_unique<InputStreamHandler> (*this, endpoint));
+                auto instanceHandle = lastHandle++;
+                CMAJ_ASSERT (instanceHandle == endpoint.handle + instanceIndex * numHandlesPerInstance); // handles must be in order
+
+                if (endpoint.details.isInput)
+                {
+                    if (endpoint.details.isEvent())
+                    {
+                        auto h = std::make_unique<InputEventHandler> (*this, *jit, endpoint);
+                        maxEventDataSize = std::max (maxEventDataSize, h->getMaxDataSize());
+                        endpointHandlers.push_back (std::move (h));
+                    }
+                    else if (endpoint.details.isStream())
+                        endpointHandlers.push_back (std::make_unique<InputStreamHandler> (*this, *jit, endpoint));
+                    else
+                        endpointHandlers.push_back (std::make_unique<InputValueHandler> (*jit, endpoint));
+                }
+                else if (endpoint.details.isEvent())
+                {
+                    auto h = std::make_unique<OutputEventHandler> (*this, *jit, endpoint, instanceHandle);
+                    outputEventHandlers.push_back (h.get());
+                    endpointHandlers.push_back (std::move (h));
+                }
                 else
-                    endpointHandlers.push_back (std::make_unique<InputValueHandler> (*this, endpoint));
-            }
-            else if (endpoint.details.isEvent())
-            {
-                auto h = std::make_unique<OutputEventHandler> (*this, endpoint);
-                outputEventHandlers.push_back (h.get());
-                endpointHandlers.push_back (std::move (h));
-            }
-            else
-            {
-                auto h = std::make_unique<OutputStreamOrValueHandler> (*this, endpoint);
-                endpointHandlers.push_back (std::move (h));
+                {
+                    auto h = std::make_unique<OutputStreamOrValueHandler> (*jit, endpoint);
+
+                    if (endpoint.details.isStream())
+                        outputStreamHandlers.push_back (h.get());
+
+                    endpointHandlers.push_back (std::move (h));
+                }
             }
         }
+
+        // space for each instance to queue a block's worth of events with addInputEventAtFrame(),
+        // so that it never needs to allocate
+        auto maxQueuedEvents = std::max (eventBufferSize, 1u) * static_cast<uint32_t> (instances.size());
+        queuedEvents.reserve (maxQueuedEvents);
+        queuedEventData.reserve (maxQueuedEvents * ((maxEventDataSize + 7u) & ~7u));
     }
 
     //==============================================================================
@@ -594,21 +925,54 @@ private:
         virtual Result setInputFrames (const void*, uint32_t, uint32_t)                            { CMAJ_ASSERT_FALSE; }
         virtual Result setInputValue (const void*, uint32_t)                                       { CMAJ_ASSERT_FALSE; }
         virtual Result addInputEvent (uint32_t, const void*)                                       { CMAJ_ASSERT_FALSE; }
+        virtual Result queueInputEvent (uint32_t, const void*, uint32_t)                           { CMAJ_ASSERT_FALSE; }
         virtual Result copyOutputValue (void*)                                                     { CMAJ_ASSERT_FALSE; }
         virtual Result copyOutputFrames (void*, uint32_t)                                          { CMAJ_ASSERT_FALSE; }
         virtual Result iterateOutputEvents (void*, PerformerInterface::HandleOutputEventCallback)  { CMAJ_ASSERT_FALSE; }
+        virtual void* getStreamBuffer (uint32_t&)                                                  { return nullptr; }
+        virtual void setBlockInput (const void*, uint32_t)                                         { CMAJ_ASSERT_FALSE; }
+        virtual void copyBlockOutput (void*, uint32_t)                                             { CMAJ_ASSERT_FALSE; }
+
+        bool canBeBoundAsInput = false, canBeBoundAsOutput = false;
     };
 
     //==============================================================================
     struct InputStreamHandler  : public EndpointHandler
     {
-        InputStreamHandler (PerformerBase& p, const EndpointInfo& endpoint) : owner (p)
+        InputStreamHandler (PerformerBase& p, JITInstance& jit, const EndpointInfo& endpoint) : owner (p)
+        {
+            setInputStreamFrames = jit.createSetInputStreamFramesFunction (endpoint);
+            directBuffer = jit.getStreamBuffer (endpoint, directBufferStride);
+            canBeBoundAsInput = true;
+        }
+
+        void* getStreamBuffer (uint32_t& frameStride) override
+        {
+            // once the caller can write to the buffer, we can't assume it's still silent
+            directBufferIsShared = true;
+            frameStride = directBufferStride;
+            return directBuffer;
+        }
+
+        void setBlockInput (const void* frameData, uint32_t numFrames) override
         {
-            setInputStreamFrames = owner.jit.createSetInputStreamFramesFunction (endpoint);
+            if (frameData == nullptr)
+                return setSilent (numFrames);
+
+            numSilentFrames = 0;
+            setInputStreamFrames (frameData, numFrames, 0);
         }
 
         Result setInputFrames (const void* frameData, uint32_t numFrames, uint32_t framesForBlock) override
         {
+            if (frameData == nullptr)
+            {
+                setSilent (framesForBlock);
+                return Result::Ok;
+            }
+
+            numSilentFrames = 0;
+
             if (numFrames == framesForBlock)
             {
                 setInputStreamFrames (frameData, numFrames, 0);
@@ -626,16 +990,31 @@ private:
             return Result::Ok;
         }
 
+        // A null block of frames means silence. The generated code never writes to its input
+        // buffers, so once they've been cleared, a stream that stays silent costs nothing to feed.
+        void setSilent (uint32_t numFrames)
+        {
+            if (numFrames > numSilentFrames || directBufferIsShared)
+            {
+                setInputStreamFrames (nullptr, 0, numFrames);
+                numSilentFrames = numFrames;
+            }
+        }
+
         PerformerBase& owner;
         std::function<void(const void*, uint32_t, uint32_t)> setInputStreamFrames;
+        void* directBuffer = nullptr;
+        uint32_t directBufferStride = 0, numSilentFrames = 0;
+        bool directBufferIsShared = false;
     };
 
     //==============================================================================
     struct InputValueHandler  : public EndpointHandler
     {
-        InputValueHandler (PerformerBase& owner, const EndpointInfo& endpoint)
+        InputValueHandler (JITInstance& jit, const EndpointInfo& endpoint)
         {
-            setInputValueFn = owner.jit.createSetInputValueFunction (endpoint);
+            setInputValueFn = jit.createSetInputValueFunction (endpoint);
+            canBeBoundAsInput = true;
         }
 
         Result setInputValue (const void* valueData, uint32_t numFramesToReachValue) override
@@ -644,6 +1023,13 @@ private:
             return Result::Ok;
         }
 
+        // A null value leaves the endpoint's previous value in place
+        void setBlockInput (const void* valueData, uint32_t) override
+        {
+            if (valueData != nullptr)
+                setInputValueFn (valueData, 0);
+        }
+
         std::function<void(const void*, uint32_t)> setInputValueFn;
         uint32_t dataTypeSize = 0;
     };
@@ -651,16 +1037,16 @@ private:
     //==============================================================================
     struct InputEventHandler : public EndpointHandler
     {
-        InputEventHandler (PerformerBase& owner, const EndpointInfo& endpoint)
+        InputEventHandler (PerformerBase& p, JITInstance& j, const EndpointInfo& endpoint) : owner (p), jit (j)
         {
+            uint32_t typeIndex = 0;
+
             for (auto& dataType : endpoint.endpoint.dataTypes)
             {
                 auto& t = AST::castToRefSkippingReferences<AST::TypeBase> (dataType);
-                std::function<void(const void*)> handler;
+                auto handler = jit.createSendEventFunction (endpoint, typeIndex++, t);
 
-                if (auto handlerFunction = AST::findEventHandlerFunction (endpoint.endpoint, t))
-                    handler = owner.jit.createSendEventFunction (endpoint, t, *handlerFunction);
-                else
+                if (handler == nullptr)
                     handler = [] (const void*) {};
 
                 auto type = t.toChocType();
@@ -679,6 +1065,26 @@ private:
             return Result::Ok;
         }
 
+        Result queueInputEvent (uint32_t typeIndex, const void* eventData, uint32_t frameOffset) override
+        {
+            if (typeIndex >= typeHandlers.size())
+                return Result::TypeIndexOutOfRange;
+
+            auto& t = typeHandlers[typeIndex];
+            owner.queueEvent (jit, t.handler, eventData, t.dataSize, frameOffset);
+            return Result::Ok;
+        }
+
+        uint32_t getMaxDataSize() const
+        {
+            uint32_t maxSize = 0;
+
+            for (auto& t : typeHandlers)
+                maxSize = std::max (maxSize, t.dataSize);
+
+            return maxSize;
+        }
+
         struct TypeHandler
         {
             choc::value::Type type;
@@ -686,16 +1092,46 @@ private:
             std::function<void(const void*)> handler;
         };
 
+        PerformerBase& owner;
+        JITInstance& jit;
         std::vector<TypeHandler> typeHandlers;
     };
 
     //==============================================================================
     struct OutputStreamOrValueHandler  : public EndpointHandler
     {
-        OutputStreamOrValueHandler (PerformerBase& owner, const EndpointInfo& endpoint)
+        OutputStreamOrValueHandler (JITInstance& jit, const EndpointInfo& endpoint)
         {
-            copyOutputValueFn = owner.jit.createCopyOutputValueFunction (endpoint);
+            copyOutputValueFn = jit.createCopyOutputValueFunction (endpoint);
             isStream = endpoint.details.isStream();
+
+            if (isStream)
+                directBuffer = jit.getStreamBuffer (endpoint, directBufferStride);
+
+            canBeBoundAsOutput = true;
+        }
+
+        void copyBlockOutput (void* dest, uint32_t numFrames) override
+        {
+            copyOutputValueFn (dest, numFrames);
+        }
+
+        void* getStreamBuffer (uint32_t& frameStride) override
+        {
+            if (! isStream || directBuffer == nullptr)
+                return nullptr;
+
+            // the generated code adds to its output streams rather than overwriting them,
+            // so once the caller is reading them in-place, we need to clear them for it
+            needsClearing = true;
+            frameStride = directBufferStride;
+            return directBuffer;
+        }
+
+        void clearDirectBuffer (uint32_t numFrames)
+        {
+            if (needsClearing)
+                memset (directBuffer, 0, directBufferStride * numFrames);
         }
 
         Result copyOutputValue (void* dest) override
@@ -709,7 +1145,9 @@ private:
         }
 
         uint32_t dataTypeSize = 0;
-        bool isStream = false;
+        bool isStream = false, needsClearing = false;
+        void* directBuffer = nullptr;
+        uint32_t directBufferStride = 0;
 
         std::function<Result(void*, uint32_t)> copyOutputValueFn;
     };
@@ -717,13 +1155,13 @@ private:
     //==============================================================================
     struct OutputEventHandler : public EndpointHandler
     {
-        OutputEventHandler (PerformerBase& p, const EndpointInfo& endpoint)
-            : owner (p), handle (endpoint.handle)
+        OutputEventHandler (PerformerBase& p, JITInstance& jit, const EndpointInfo& endpoint, EndpointHandle instanceHandle)
+            : owner (p), handle (instanceHandle)
         {
-            getNumOutputEvents = owner.jit.createGetNumOutputEventsFunction (endpoint);
-            getEventTypeIndex  = owner.jit.createGetEventTypeIndexFunction (endpoint);
-            readOutputEvent    = owner.jit.createReadOutputEventFunction (endpoint);
-            resetEventCount    = owner.jit.createResetEventCountFunction (endpoint);
+            getNumOutputEvents = jit.createGetNumOutputEventsFunction (endpoint);
+            getEventTypeIndex  = jit.createGetEventTypeIndexFunction (endpoint);
+            readOutputEvent    = jit.createReadOutputEventFunction (endpoint);
+            resetEventCount    = jit.createResetEventCountFunction (endpoint);
 
             queue.initialise (endpoint.details, owner.eventBufferSize);
         }
@@ -823,8 +1261,10 @@ private:
 
     //==============================================================================
     std::vector<std::unique_ptr<EndpointHandler>> endpointHandlers;
-    uint32_t firstHandle = 0, lastHandle = 0;
+    uint32_t firstHandle = 0, lastHandle = 0, numHandlesPerInstance = 0;
     std::vector<OutputEventHandler*> outputEventHandlers;
+    std::vector<OutputStreamOrValueHandler*> outputStreamHandlers;
+    std::vector<EndpointHandler*> inputBindings, outputBindings;
 
     EndpointHandler* getEndpointHandler (EndpointHandle handle)
     {
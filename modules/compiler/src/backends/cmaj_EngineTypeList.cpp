@@ -92,6 +92,7 @@ struct DummyEngineFactory  : public choc::com::ObjectWithAtomicRefCount<EngineFa
         static constexpr bool usesDynamicRateAndSessionID = true;
         static constexpr bool allowTopLevelSlices = false;
         static constexpr bool supportsExternalFunctions = true;
+        static constexpr bool canLinkFromCachedCode = false;
         static bool engineSupportsIntrinsic (AST::Intrinsic::Type) { return true; }
 
         static std::string getEngineVersion()   { return "dummy"; }
@@ -99,7 +100,7 @@ struct DummyEngineFactory  : public choc::com::ObjectWithAtomicRefCount<EngineFa
         struct LinkedCode { LinkedCode (const DummyEngine&, uint32_t, double, CacheDatabaseInterface*, const char*) {} static constexpr double latency = 0; };
         struct JITInstance { JITInstance (std::shared_ptr<LinkedCode>, int32_t, double) {} };
 
-        PerformerInterface* createPerformer (std::shared_ptr<LinkedCode>) { return {}; }
+        PerformerInterface* createPerformer (std::shared_ptr<LinkedCode>, uint32_t) { return {}; }
     };
 
     const char* getName() override      { return "dummy"; }
@@ -0,0 +1,239 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined (_WIN32)
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#elif defined (__APPLE__)
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+#endif
+
+namespace cmaj
+{
+
+//==============================================================================
+/// A set of worker threads which a performer can use to spread independent pieces of
+/// work across cores during a call to advance().
+///
+/// The calling thread never locks, allocates or waits for a worker to wake up: it takes
+/// tasks from the same shared counter as the workers, so if they're all asleep it simply
+/// does all the work itself. Workers spin for a short time after each job so that they're
+/// ready for the next block, and then sleep on a semaphore, which run() signals if any of
+/// them are asleep when it starts a job.
+struct RenderThreadPool
+{
+    RenderThreadPool (uint32_t numWorkerThreads)
+    {
+        for (uint32_t i = 0; i < numWorkerThreads; ++i)
+            workers.emplace_back ([this] { runWorker(); });
+    }
+
+    ~RenderThreadPool()
+    {
+        shouldExit = true;
+
+        for (size_t i = 0; i < workers.size(); ++i)
+            wakeUpSignal.signal();
+
+        for (auto& w : workers)
+            w.join();
+    }
+
+    using TaskFn = void(*)(void* context, uint32_t taskIndex);
+
+    /// Calls the function once for each index in 0 to numTasks - 1, and returns when all
+    /// of the calls have finished. The calls may happen in any order, on any thread.
+    void run (uint32_t numTasks, void* context, TaskFn fn)
+    {
+        if (workers.empty() || numTasks < 2)
+        {
+            for (uint32_t i = 0; i < numTasks; ++i)
+                fn (context, i);
+
+            return;
+        }
+
+        // Moving to the new job ID before changing the job details means that a worker that's
+        // still looking at the previous job can't successfully claim a task using them
+        auto jobID = ++lastJobID;
+        nextTask = (jobID << 32) | notReady;
+
+        taskFn = fn;
+        taskContext = context;
+        taskCount = numTasks;
+        tasksDone = 0;
+
+        nextTask = jobID << 32;
+
+        // Posting to the semaphore is a non-blocking call, and is only made when a worker has
+        // actually gone to sleep, which it'll only do when no jobs have arrived for a while
+        for (auto numToWake = sleepingWorkers.exchange (0); numToWake > 0; --numToWake)
+            wakeUpSignal.signal();
+
+        performTasks (jobID);
+
+        while (tasksDone != numTasks)
+            std::this_thread::yield();
+    }
+
+    template <typename Fn>
+    void run (uint32_t numTasks, Fn& fn)
+    {
+        run (numTasks, std::addressof (fn), [] (void* context, uint32_t taskIndex) { (*static_cast<Fn*> (context)) (taskIndex); });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::atomic<bool> shouldExit { false };
+
+    // The top 32 bits hold the ID of the current job, and the bottom 32 the index of the
+    // next task to be claimed, so a thread can never claim a task from a job that it
+    // didn't read the details of. These all use sequentially-consistent ordering.
+    std::atomic<uint64_t> nextTask { 0 };
+    static constexpr uint64_t notReady = 0xffffffffu;
+    uint64_t lastJobID = 0;
+
+    std::atomic<TaskFn> taskFn { nullptr };
+    std::atomic<void*> taskContext { nullptr };
+    std::atomic<uint32_t> taskCount { 0 }, tasksDone { 0 };
+
+    static constexpr auto spinTimeAfterJob = std::chrono::milliseconds (5);
+
+    //==============================================================================
+    struct Semaphore
+    {
+       #if defined (_WIN32)
+        Semaphore()       : handle (CreateSemaphoreW (nullptr, 0, 0x7fffffff, nullptr)) {}
+        ~Semaphore()      { CloseHandle (handle); }
+        void signal()     { ReleaseSemaphore (handle, 1, nullptr); }
+        void wait()       { WaitForSingleObject (handle, INFINITE); }
+
+        HANDLE handle;
+       #elif defined (__APPLE__)
+        Semaphore()       : handle (dispatch_semaphore_create (0)) {}
+        ~Semaphore()      { dispatch_release (handle); }
+        void signal()     { dispatch_semaphore_signal (handle); }
+        void wait()       { dispatch_semaphore_wait (handle, DISPATCH_TIME_FOREVER); }
+
+        dispatch_semaphore_t handle;
+       #else
+        Semaphore()       { sem_init (&handle, 0, 0); }
+        ~Semaphore()      { sem_destroy (&handle); }
+        void signal()     { sem_post (&handle); }
+        void wait()       { while (sem_wait (&handle) != 0) {} }
+
+        sem_t handle;
+       #endif
+    };
+
+    Semaphore wakeUpSignal;
+    std::atomic<uint32_t> sleepingWorkers { 0 };
+
+    bool isNewJobReady (uint64_t lastJobSeen) const
+    {
+        auto next = nextTask.load();
+        return (next >> 32) != lastJobSeen && (next & notReady) != notReady;
+    }
+
+    /// Blocks until run() starts a new job or the pool is being destroyed
+    void sleepUntilNextJob (uint64_t lastJobSeen)
+    {
+        ++sleepingWorkers;
+
+        // If a job arrived after this thread last looked, it may have been too late to be
+        // counted, so it must take its name off the list again rather than going to sleep.
+        // If run() has already cleared the list, a signal is on its way, so it must consume it.
+        if (isNewJobReady (lastJobSeen) || shouldExit)
+        {
+            for (auto num = sleepingWorkers.load(); num > 0;)
+                if (sleepingWorkers.compare_exchange_weak (num, num - 1))
+                    return;
+        }
+
+        wakeUpSignal.wait();
+    }
+
+    void performTasks (uint64_t jobID)
+    {
+        for (;;)
+        {
+            auto next = nextTask.load();
+
+            if ((next >> 32) != jobID || (next & notReady) == notReady)
+                return;
+
+            auto fn = taskFn.load();
+            auto context = taskContext.load();
+            auto taskIndex = static_cast<uint32_t> (next);
+
+            if (taskIndex >= taskCount.load())
+                return;
+
+            if (nextTask.compare_exchange_weak (next, next + 1))
+            {
+                fn (context, taskIndex);
+                ++tasksDone;
+            }
+        }
+    }
+
+    void runWorker()
+    {
+        uint64_t lastJobSeen = 0;
+        auto lastJobTime = std::chrono::steady_clock::now();
+
+        while (! shouldExit)
+        {
+            auto next = nextTask.load();
+            auto jobID = next >> 32;
+
+            if (jobID != lastJobSeen && (next & notReady) != notReady)
+            {
+                lastJobSeen = jobID;
+                performTasks (jobID);
+                lastJobTime = std::chrono::steady_clock::now();
+            }
+            else if (std::chrono::steady_clock::now() - lastJobTime < spinTimeAfterJob)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                sleepUntilNextJob (lastJobSeen);
+                lastJobTime = std::chrono::steady_clock::now();
+            }
+        }
+    }
+};
+
+}
@@ -98,6 +98,40 @@ struct NativeTypeLayout
         return getNativeSize();
     }
 
+    /// Returns the chunk list in a form that can be stored and later passed to
+    /// restoreChunks(), to rebuild the layout without needing a code generator.
+    choc::value::Value getChunksAsValue() const
+    {
+        auto result = choc::value::createEmptyArray();
+
+        for (auto& c : chunks)
+            result.addArrayElement (choc::value::createVector (4, [&] (uint32_t i)
+            {
+                return static_cast<int32_t> (i == 0 ? c.packedOffset : i == 1 ? c.nativeOffset : i == 2 ? c.numBytes : c.numBits);
+            }));
+
+        return result;
+    }
+
+    bool restoreChunks (const choc::value::ValueView& chunkList)
+    {
+        chunks.clear();
+
+        if (! chunkList.isArray())
+            return false;
+
+        for (auto c : chunkList)
+        {
+            if (c.size() != 4)
+                return false;
+
+            chunks.push_back ({ static_cast<uint32_t> (c[0].getInt32()), static_cast<uint32_t> (c[1].getInt32()),
+                                static_cast<uint32_t> (c[2].getInt32()), static_cast<uint32_t> (c[3].getInt32()) });
+        }
+
+        return true;
+    }
+
     const AST::TypeBase& type;
 
 private:
@@ -202,6 +202,12 @@ DECL_COMPILE_ERROR (externalFunctionCannotBeGeneric,        "An external functio
 DECL_COMPILE_ERROR (externalFunctionCannotUseParamType,     "An external function can only take primitive parameter types")
 DECL_COMPILE_ERROR (externalFunctionsNotSupported,          "The target back-end does not support external functions")
 
+// Frozen endpoints
+DECL_COMPILE_ERROR (cannotFindEndpointToFreeze,             "Cannot find an input endpoint called '{0}' to freeze")
+DECL_COMPILE_ERROR (cannotFreezeEndpoint,                   "The endpoint '{0}' cannot be frozen - only non-array value and event inputs with a single data type can be given a fixed value")
+DECL_COMPILE_ERROR (cannotApplyFrozenEndpointValue,         "Cannot apply value of type '{0}' to frozen endpoint '{1}'")
+DECL_COMPILE_ERROR (cannotFreezeEndpointInUse,              "The endpoint '{0}' cannot be frozen because a handle to it has been requested")
+
 // Function-related errors
 DECL_COMPILE_ERROR (tooManyParameters,                      "Too many function parameters")
 DECL_COMPILE_ERROR (duplicateFunction,                      "A function with matching parameters has already been defined")
@@ -31,6 +31,10 @@ namespace cmaj::passes
         size_t numReplaced = 0, numFailures = 0;
         bool throwOnErrors = false;
 
+        /// If this is set, then whenever a change or failure is registered, the object
+        /// that was being visited (or nullptr if unknown) is added to it
+        std::vector<AST::Object*>* affectedObjects = nullptr;
+
         /// Replaces an object and also registers a change
         void replaceObject (AST::Object& old, AST::Object& replacement)
         {
@@ -54,12 +58,20 @@ namespace cmaj::passes
         bool registerFailure()
         {
             ++numFailures;
+            addAffectedObject();
             return throwOnErrors;
         }
 
         void registerChange()
         {
             ++numReplaced;
+            addAffectedObject();
+        }
+
+        void addAffectedObject()
+        {
+            if (affectedObjects != nullptr)
+                affectedObjects->push_back (visitStack.empty() ? nullptr : visitStack.back());
         }
     };
 
@@ -144,3 +156,4 @@ namespace cmaj::passes
 #include "cmaj_EndpointResolver.h"
 #include "cmaj_StrengthReduction.h"
 #include "cmaj_ExternalResolver.h"
+#include "cmaj_ResolutionPassManager.h"
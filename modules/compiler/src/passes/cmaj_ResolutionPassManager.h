@@ -0,0 +1,225 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace cmaj::passes
+{
+
+//==============================================================================
+/// Runs the resolution passes over a program repeatedly until none of them make any
+/// more changes.
+///
+/// After each round, a module in which nothing changed or failed, and which doesn't
+/// refer to anything in a module that did change, is treated as settled and is skipped
+/// by later rounds. A module that was created during the round (e.g. a specialisation)
+/// counts as changed, because some of the passes ran before it existed. A namespace is
+/// only settled when all of its sub-modules are. The
+/// first round still has to walk the whole program, but later rounds only visit the
+/// parts of it that are still being resolved, rather than re-walking everything
+/// including the standard library.
+struct ResolutionPassManager
+{
+    ResolutionPassManager (AST::Program& p) : program (p) {}
+
+    /// If revisitAllModules is true, every round walks the whole program.
+    void run (bool throwOnErrors, bool revisitAllModules)
+    {
+        if (! revisitAllModules)
+            findNewModules (program.rootNamespace);
+
+        for (;;)
+        {
+            affectedObjects.clear();
+
+            PassResult result;
+
+            result += runPass<TypeResolver>         (throwOnErrors);
+            result += runPass<FunctionResolver>     (throwOnErrors);
+            result += runPass<NameResolver>         (throwOnErrors);
+            result += runPass<ModuleSpecialiser>    (throwOnErrors);
+            result += runPass<ProcessorResolver>    (throwOnErrors);
+            result += runPass<EndpointResolver>     (throwOnErrors);
+            result += runPass<ConstantFolder>       (throwOnErrors);
+            result += runPass<StrengthReduction>    (throwOnErrors);
+            result += runPass<ExternalResolver>     (throwOnErrors);
+
+            if (result.numChanges == 0)
+                return;
+
+            if (! revisitAllModules)
+                updateSettledModules();
+        }
+    }
+
+private:
+    //==============================================================================
+    using ModuleSet = std::unordered_set<const AST::ModuleBase*>;
+
+    AST::Program& program;
+    std::vector<AST::Object*> affectedObjects;
+    ModuleSet settledModules, changedModules, knownModules;
+    std::unordered_map<const AST::ModuleBase*, std::vector<const AST::ModuleBase*>> dependencies;
+
+    template <typename PassType>
+    struct PassSkippingSettledModules  : public PassType
+    {
+        PassSkippingSettledModules (AST::Program& p, const ModuleSet& s) : PassType (p), settled (s) {}
+
+        bool shouldVisitObject (AST::Object& o) override
+        {
+            if (auto m = o.getAsModuleBase())
+                if (settled.find (m) != settled.end())
+                    return false;
+
+            return PassType::shouldVisitObject (o);
+        }
+
+        const ModuleSet& settled;
+    };
+
+    template <typename PassType>
+    PassResult runPass (bool throwOnErrors)
+    {
+        PassSkippingSettledModules<PassType> pass (program, settledModules);
+        pass.throwOnErrors = throwOnErrors;
+        pass.affectedObjects = std::addressof (affectedObjects);
+        pass.visitObject (program.rootNamespace);
+
+        return { pass.numReplaced, pass.numFailures };
+    }
+
+    //==============================================================================
+    static const AST::ModuleBase* getOwningModule (const AST::Object& o)
+    {
+        if (auto m = o.getAsModuleBase())
+            return m;
+
+        return o.findParentModule().get();
+    }
+
+    void updateSettledModules()
+    {
+        changedModules.clear();
+
+        for (auto o : affectedObjects)
+        {
+            // If a pass registers a change without an object, we can't tell what it affected
+            if (o == nullptr)
+            {
+                settledModules.clear();
+                dependencies.clear();
+                return;
+            }
+
+            if (auto m = getOwningModule (*o))
+                changedModules.insert (m);
+        }
+
+        findNewModules (program.rootNamespace);
+
+        for (auto m : changedModules)
+            dependencies.erase (m);
+
+        settledModules.clear();
+        updateSettledState (program.rootNamespace);
+    }
+
+    void findNewModules (AST::ModuleBase& module)
+    {
+        if (knownModules.insert (std::addressof (module)).second)
+            changedModules.insert (std::addressof (module));
+
+        if (auto ns = module.getAsNamespace())
+            for (auto& sub : ns->subModules.iterateAs<AST::ModuleBase>())
+                findNewModules (sub);
+    }
+
+    bool updateSettledState (AST::ModuleBase& module)
+    {
+        bool settled = changedModules.count (std::addressof (module)) == 0;
+
+        if (settled)
+            for (auto d : getDependencies (module))
+                if (changedModules.count (d) != 0)
+                    settled = false;
+
+        if (auto ns = module.getAsNamespace())
+            for (auto& sub : ns->subModules.iterateAs<AST::ModuleBase>())
+                if (! updateSettledState (sub))
+                    settled = false;
+
+        if (settled)
+            settledModules.insert (std::addressof (module));
+
+        return settled;
+    }
+
+    /// Returns the modules containing anything that this module's own content refers
+    /// to. These are only re-calculated after the module itself has changed.
+    const std::vector<const AST::ModuleBase*>& getDependencies (AST::ModuleBase& module)
+    {
+        auto found = dependencies.find (std::addressof (module));
+
+        if (found != dependencies.end())
+            return found->second;
+
+        ModuleSet result;
+
+        for (auto p : module.getPropertyList())
+            addDependencies (*p, result);
+
+        result.erase (std::addressof (module));
+        auto& deps = dependencies[std::addressof (module)];
+        deps.assign (result.begin(), result.end());
+        return deps;
+    }
+
+    static void addDependencies (AST::Property& p, ModuleSet& result)
+    {
+        if (auto list = p.getAsListProperty())
+        {
+            for (auto& item : *list)
+                addDependencies (item.get(), result);
+
+            return;
+        }
+
+        if (auto objectProperty = p.getAsObjectProperty())
+        {
+            if (auto target = objectProperty->getRawPointer())
+            {
+                if (! objectProperty->isParentOfObject())
+                {
+                    if (auto m = getOwningModule (*target))
+                        result.insert (m);
+                }
+                else if (target->getAsModuleBase() == nullptr)
+                {
+                    for (auto child : target->getPropertyList())
+                        addDependencies (*child, result);
+                }
+            }
+        }
+    }
+};
+
+}
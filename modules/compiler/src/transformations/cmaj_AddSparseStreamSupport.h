@@ -20,11 +20,115 @@ namespace cmaj::transformations
 {
 
 //==============================================================================
-inline void addSparseStreamSupport (AST::Program& program)
+/// Strips out any stream connections inside a graph whose sources are known to be silent,
+/// i.e. constant zeros, or stream outputs which their processor never writes to. A stream
+/// input starts each frame at zero and then has its sources summed into it, so removing
+/// these connections saves the sums without changing anything that the destination sees.
+/// Sources which only go silent at runtime are handled by the flattened graph, which skips
+/// the sums for nodes that have gone to sleep.
+static inline void addSparseStreamSupport (AST::Program& program)
 {
-    auto& mainProcessor = program.getMainProcessor();
+    struct SilentConnectionRemover
+    {
+        std::unordered_set<const AST::EndpointDeclaration*> writtenEndpoints;
 
-    (void) mainProcessor;
+        void run (AST::ProcessorBase& mainProcessor)
+        {
+            mainProcessor.getRootNamespace().visitAllModules (true, [this] (AST::ModuleBase& m)
+            {
+                if (auto p = m.getAsProcessorBase())
+                {
+                    p->visitObjectsInScope ([this] (AST::Object& s)
+                    {
+                        if (auto w = s.getAsWriteToEndpoint())
+                            if (auto endpointDeclaration = w->getEndpoint())
+                                writtenEndpoints.insert (endpointDeclaration.get());
+                    });
+                }
+            });
+
+            mainProcessor.getRootNamespace().visitAllModules (true, [this] (AST::ModuleBase& m)
+            {
+                if (auto g = m.getAsGraph())
+                    if (! g->isGenericOrParameterised())
+                        removeSilentConnections (*g);
+            });
+        }
+
+        void removeSilentConnections (AST::Graph& graph)
+        {
+            std::unordered_set<const AST::Connection*> connectionsToRemove;
+
+            graph.visitConnections ([&] (AST::Connection& c)
+            {
+                if (c.sources.empty() || c.dests.empty())
+                    return;
+
+                for (auto& source : c.sources)
+                    if (! isSilentSource (source->getObjectRef()))
+                        return;
+
+                for (auto& dest : c.dests)
+                    if (! isStreamDestination (dest->getObjectRef()))
+                        return;
+
+                connectionsToRemove.insert (std::addressof (c));
+            });
+
+            if (! connectionsToRemove.empty())
+                graph.removeConnections (connectionsToRemove);
+        }
+
+        bool isSilentSource (AST::Object& source) const
+        {
+            if (auto element = AST::castToSkippingReferences<AST::GetElement> (source))
+                if (auto endpointInstance = AST::castToSkippingReferences<AST::EndpointInstance> (element->parent))
+                    return isSilentSource (*endpointInstance);
+
+            if (auto endpointInstance = AST::castToSkippingReferences<AST::EndpointInstance> (source))
+                return isSilentSource (*endpointInstance);
+
+            if (AST::castToSkippingReferences<AST::Connection> (source) != nullptr)
+                return false;
+
+            if (auto value = AST::castToSkippingReferences<AST::ValueBase> (source))
+                if (auto constant = AST::getAsFoldedConstant (*value))
+                    return constant->isZero();
+
+            return false;
+        }
+
+        bool isSilentSource (AST::EndpointInstance& source) const
+        {
+            // Graph inputs come from outside, and a graph's outputs are written by its own connections
+            if (source.isParentEndpoint() || source.getNode().getProcessorType()->getAsGraph() != nullptr)
+                return false;
+
+            auto endpoint = source.getEndpoint (true);
+
+            return endpoint != nullptr
+                    && endpoint->isStream()
+                    && writtenEndpoints.find (endpoint.get()) == writtenEndpoints.end();
+        }
+
+        static bool isStreamDestination (AST::Object& dest)
+        {
+            ptr<AST::EndpointInstance> endpointInstance;
+
+            if (auto element = AST::castToSkippingReferences<AST::GetElement> (dest))
+                endpointInstance = AST::castToSkippingReferences<AST::EndpointInstance> (element->parent);
+            else
+                endpointInstance = AST::castToSkippingReferences<AST::EndpointInstance> (dest);
+
+            if (endpointInstance == nullptr)
+                return false;
+
+            auto endpoint = endpointInstance->getEndpoint (false);
+            return endpoint != nullptr && endpoint->isStream();
+        }
+    };
+
+    SilentConnectionRemover().run (program.getMainProcessor());
 }
 
 }
@@ -28,6 +28,8 @@ namespace cmaj::transformations
         - Series of objects (first ones being the top-level objects), where an object is:
             - 1 byte: object class
             - compressed int: parent ID  (must be 0 for a top-level object)
+            - compressed int: only present if the module was written with a source file for
+              locations, this is 1 + the object's offset into that file, or 0 if it has none
             - 1 byte: number of properties
             - ..list of stored properties
 
@@ -41,7 +43,8 @@ static constexpr size_t numObjectsToReserve = 16384;
 //==============================================================================
 struct BinaryModuleWriter
 {
-    BinaryModuleWriter()
+    BinaryModuleWriter (const SourceFile* sourceForLocations = nullptr)
+        : locationSource (sourceForLocations)
     {
         objectIDs.reserve (numObjectsToReserve);
         objectsToStore.reserve (numObjectsToReserve);
@@ -108,6 +111,9 @@ struct BinaryModuleWriter
         writeByte (o.getObjectClassID());
         writeCompressedInt (isMainObject ? 0 : addObjectToStore (o.context.parentScope.get()));
 
+        if (locationSource != nullptr)
+            writeCompressedInt (getLocationOffset (o.context.location));
+
         auto props = o.getPropertyList();
         uint32_t numActiveProps = 0;
 
@@ -129,6 +135,14 @@ struct BinaryModuleWriter
         }
     }
 
+    int64_t getLocationOffset (CodeLocation location) const
+    {
+        if (location.empty() || ! locationSource->contains (location))
+            return 0;
+
+        return static_cast<int64_t> (location.text.data() - locationSource->content.data()) + 1;
+    }
+
     void writeProperty (const AST::Property& prop)
     {
         if (auto p = prop.getAsIntegerProperty())
@@ -194,14 +208,16 @@ struct BinaryModuleWriter
         choc::memory::writeLittleEndian (data.data() + hashOffset, hash.getHash());
     }
 
+    const SourceFile* locationSource;
     std::vector<uint8_t> data;
     std::unordered_map<AST::Object*, uint32_t> objectIDs;
     std::vector<AST::Object*> objectsToStore;
 };
 
-std::vector<uint8_t> createBinaryModule (const AST::ObjectRefVector<AST::ModuleBase>& objects)
+std::vector<uint8_t> createBinaryModule (const AST::ObjectRefVector<AST::ModuleBase>& objects,
+                                         const SourceFile* sourceForLocations)
 {
-    BinaryModuleWriter data;
+    BinaryModuleWriter data (sourceForLocations);
     data.store (objects);
     return std::move (data.data);
 }
@@ -209,7 +225,8 @@ std::vector<uint8_t> createBinaryModule (const AST::ObjectRefVector<AST::ModuleB
 //==============================================================================
 struct BinaryModuleReader
 {
-    BinaryModuleReader (const uint8_t* d, size_t s) : data (d), size (s)
+    BinaryModuleReader (const uint8_t* d, size_t s, const SourceFile* sourceForLocations = nullptr)
+        : data (d), size (s), locationSource (sourceForLocations)
     {
         objectProperiesToResolve.reserve (numObjectsToReserve);
     }
@@ -233,7 +250,7 @@ struct BinaryModuleReader
             auto classID  = readByte();
             auto parentID = readCompressedUInt32();
 
-            AST::ObjectContext context { allocator, {}, nullptr };
+            AST::ObjectContext context { allocator, readLocation(), nullptr };
 
             if (auto p = getObjectFromID (parentID))
                 context.parentScope = *p;
@@ -361,6 +378,22 @@ struct BinaryModuleReader
         return static_cast<uint32_t> (n);
     }
 
+    CodeLocation readLocation()
+    {
+        if (locationSource == nullptr)
+            return {};
+
+        auto offset = readCompressedUInt32();
+
+        if (offset == 0)
+            return {};
+
+        if (offset - 1 > locationSource->content.length())
+            throwError();
+
+        return CodeLocation (choc::text::UTF8Pointer (locationSource->content.data() + (offset - 1)));
+    }
+
     std::string_view readZeroTerminatedString()
     {
         for (auto start = data;;)
@@ -592,6 +625,7 @@ struct BinaryModuleReader
 
     const uint8_t* data;
     size_t size;
+    const SourceFile* locationSource;
 
     struct ParentToResolve
     {
@@ -611,12 +645,12 @@ struct BinaryModuleReader
 
 //==============================================================================
 AST::ObjectRefVector<AST::ModuleBase> parseBinaryModule (AST::Allocator& allocator, const void* data, size_t size,
-                                                         bool checkHashValidity)
+                                                         bool checkHashValidity, const SourceFile* sourceForLocations)
 {
     try
     {
         AST::ObjectRefVector<AST::ModuleBase> results;
-        BinaryModuleReader reader (static_cast<const uint8_t*> (data), size);
+        BinaryModuleReader reader (static_cast<const uint8_t*> (data), size, sourceForLocations);
         reader.read (allocator, results, checkHashValidity);
         return results;
     }
@@ -202,11 +202,15 @@ inline AST::ProcessorBase& createBlockTransformProcessor (AST::ProcessorBase& or
                                                               frequencyParam));
     }
 
-    // _advance function definition
+    // Creates a function that renders frames until the current frame reaches the given
+    // count. The _advance function renders the rest of the block and then resets the frame
+    // counter, and _advanceToFrame stops part-way through a block, so that the performer can
+    // deliver an event at that frame before carrying on.
+    auto createAdvanceFunction = [&] (AST::PooledString functionName, bool isEndOfBlock)
     {
         auto& advance = AST::createExportedFunction (blockProcessor,
                                                      blockProcessor.context.allocator.voidType,
-                                                     blockProcessor.getStrings().systemAdvanceFunctionName);
+                                                     functionName);
 
         auto stateParam  = AST::addFunctionParameter (advance, stateType, advance.getStrings()._state, true, false);
         auto ioParam     = AST::addFunctionParameter (advance, ioType,    advance.getStrings()._io, true, false);
@@ -234,19 +238,21 @@ inline AST::ProcessorBase& createBlockTransformProcessor (AST::ProcessorBase& or
 
         loopBlock.addStatement (ifStatement);
 
+        // Values can only change between calls to this function, so the ones that don't ramp
+        // are copied into the wrapped processor once per call rather than on every frame
+        for (auto input : blockProcessor.getInputEndpoints (true))
+            if (input->isValue() && ! ValueStreamUtilities::dataTypeCanBeInterpolated (input))
+                mainBlock.addStatement (AST::createAssignment (mainBlock.context,
+                                                               ValueStreamUtilities::getStateStructMember (mainBlock.context, input, AST::createGetStructMember (mainBlock.context, stateParam, "_state"), false),
+                                                               ValueStreamUtilities::getStateStructMember (mainBlock.context, input, stateParam, true)));
+
         if (auto updateRampsBlock = ValueStreamUtilities::addUpdateRampsCall (blockProcessor, loopBlock, stateParam))
         {
             for (auto input : blockProcessor.getInputEndpoints (true))
-            {
-                if (input->isValue())
-                {
-                    auto& block = ValueStreamUtilities::dataTypeCanBeInterpolated (input) ? *updateRampsBlock : loopBlock;
-
-                    block.addStatement (AST::createAssignment (block.context,
-                                                               ValueStreamUtilities::getStateStructMember (block.context, input, AST::createGetStructMember (block.context, stateParam, "_state"), false),
-                                                               ValueStreamUtilities::getStateStructMember (block.context, input, stateParam, true)));
-                }
-            }
+                if (input->isValue() && ValueStreamUtilities::dataTypeCanBeInterpolated (input))
+                    updateRampsBlock->addStatement (AST::createAssignment (updateRampsBlock->context,
+                                                                           ValueStreamUtilities::getStateStructMember (updateRampsBlock->context, input, AST::createGetStructMember (updateRampsBlock->context, stateParam, "_state"), false),
+                                                                           ValueStreamUtilities::getStateStructMember (updateRampsBlock->context, input, stateParam, true)));
         }
 
         auto& ioVariable = AST::createLocalVariable (loopBlock, "ioCopy", EventHandlerUtilities::getOrCreateIoStructType (originalProcessor), {});
@@ -285,6 +291,9 @@ inline AST::ProcessorBase& createBlockTransformProcessor (AST::ProcessorBase& or
         loopBlock.addStatement (AST::createPreInc (loopBlock.context, currentFrame));
         mainBlock.addStatement (loop);
 
+        if (! isEndOfBlock)
+            return;
+
         for (auto output : blockProcessor.getOutputEndpoints (true))
             if (output->isValue())
             {
@@ -298,7 +307,10 @@ inline AST::ProcessorBase& createBlockTransformProcessor (AST::ProcessorBase& or
         mainBlock.addStatement (AST::createAssignment (mainBlock.context,
                                                        currentFrame,
                                                        mainBlock.context.allocator.createConstantInt32 (0)));
-    }
+    };
+
+    createAdvanceFunction (blockProcessor.getStrings().systemAdvanceFunctionName, true);
+    createAdvanceFunction (blockProcessor.getStrings().advanceToFrameFunctionName, false);
 
     return blockProcessor;
 }
@@ -0,0 +1,292 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+
+namespace cmaj::transformations
+{
+
+//==============================================================================
+/// Replaces the main processor's input endpoints which have been given a fixed value
+/// in the build settings with constants, so that everything that depends on them can
+/// be folded away.
+///
+/// Value endpoints have their reads replaced by the constant. Event endpoints lose their
+/// handler, which gets called once from init() with the constant instead. In a graph,
+/// the value is pushed down into any child nodes that the endpoint feeds on its own,
+/// cloning the child's processor if other nodes share it. Values which can't be pushed
+/// down are connected to their destinations as constant expressions.
+///
+/// Returns true if any endpoints were frozen.
+static inline bool freezeInputEndpoints (AST::Program& program, const choc::value::ValueView& frozenValues)
+{
+    struct EndpointFreezer
+    {
+        EndpointFreezer (AST::Program& p) : program (p) {}
+
+        void freeze (AST::ProcessorBase& processor, AST::EndpointDeclaration& endpoint, const choc::value::ValueView& value)
+        {
+            if (! canBeFrozen (endpoint))
+                throwError (endpoint, Errors::cannotFreezeEndpoint (endpoint.getName()));
+
+            if (auto graph = processor.getAsGraph())
+                freezeGraphEndpoint (*graph, endpoint, value);
+            else if (endpoint.isValue())
+                freezeValueEndpoint (processor, endpoint, value);
+            else
+                freezeEventEndpoint (processor, endpoint, value);
+
+            processor.endpoints.removeObject (endpoint);
+        }
+
+    private:
+        AST::Program& program;
+
+        static bool canBeFrozen (const AST::EndpointDeclaration& endpoint)
+        {
+            return endpoint.isInput
+                    && ! endpoint.isStream()
+                    && ! endpoint.isArray()
+                    && endpoint.dataTypes.size() == 1
+                    && ! AST::castToTypeBaseRef (endpoint.dataTypes[0]).isVoid();
+        }
+
+        static AST::ConstantValueBase& createConstant (const AST::ObjectContext& context,
+                                                       const AST::EndpointDeclaration& endpoint,
+                                                       const choc::value::ValueView& value)
+        {
+            auto& constant = AST::castToTypeBaseRef (endpoint.dataTypes[0]).allocateConstantValue (context);
+
+            if (! constant.setFromValue (value))
+                throwError (endpoint, Errors::cannotApplyFrozenEndpointValue (value.getType().getDescription(), endpoint.getName()));
+
+            return constant;
+        }
+
+        void freezeValueEndpoint (AST::ProcessorBase& processor, const AST::EndpointDeclaration& endpoint, const choc::value::ValueView& value)
+        {
+            processor.visitObjectsInScope ([&] (AST::Object& s)
+            {
+                if (auto r = s.getAsReadFromEndpoint())
+                    if (r->getEndpointDeclaration().get() == std::addressof (endpoint))
+                        r->replaceWith (createConstant (r->context, endpoint, value));
+            });
+        }
+
+        void freezeEventEndpoint (AST::ProcessorBase& processor, const AST::EndpointDeclaration& endpoint, const choc::value::ValueView& value)
+        {
+            auto handler = EventHandlerUtilities::findEventFunctionForType (processor, endpoint.getName(),
+                                                                            AST::castToTypeBaseRef (endpoint.dataTypes[0]), false);
+
+            for (auto& fn : EventHandlerUtilities::getEventHandlerFunctionsForEndpoint (processor, endpoint))
+                if (fn != handler)
+                    processor.functions.removeObject (*fn);
+
+            if (handler == nullptr)
+                return;
+
+            // The handler becomes an ordinary function which init() calls, so the value
+            // is applied once before the first frame, like an event sent before rendering
+            handler->isEventHandler = false;
+            handler->name = processor.getStringPool().get ("_frozen_" + std::string (endpoint.getName()));
+
+            auto init = processor.findUserInitFunction();
+
+            if (init == nullptr)
+                init = AST::createFunctionInModule (processor, processor.context.allocator.createVoidType(),
+                                                    processor.getStrings().userInitFunctionName);
+
+            auto& block = *init->getMainBlock();
+            block.addStatement (AST::createFunctionCall (block.context, *handler, createConstant (block.context, endpoint, value)));
+        }
+
+        void freezeGraphEndpoint (AST::Graph& graph, const AST::EndpointDeclaration& endpoint, const choc::value::ValueView& value)
+        {
+            if (! EventHandlerUtilities::getEventHandlerFunctionsForEndpoint (graph, endpoint).empty())
+                throwError (endpoint, Errors::cannotFreezeEndpoint (endpoint.getName()));
+
+            AST::ObjectRefVector<AST::Connection> connections;
+
+            graph.visitConnections ([&] (AST::Connection& c)
+            {
+                for (auto& source : c.sources)
+                {
+                    if (isFrozenEndpoint (source->getObjectRef(), endpoint))
+                    {
+                        connections.push_back (c);
+                        break;
+                    }
+                }
+            });
+
+            for (auto& c : connections)
+            {
+                for (size_t i = 0; i < c->dests.size();)
+                {
+                    if (c->sources.size() == 1 && pushDownIntoChild (graph, endpoint, c->dests[i], value))
+                        c->dests.remove (i);
+                    else
+                        ++i;
+                }
+
+                if (c->dests.empty())
+                {
+                    removeConnection (graph.connections, *c);
+                    continue;
+                }
+
+                // Anything left over takes the value as a constant connection instead
+                if (! endpoint.isValue())
+                    throwError (endpoint, Errors::cannotFreezeEndpoint (endpoint.getName()));
+
+                for (size_t i = 0; i < c->sources.size(); ++i)
+                    if (isFrozenEndpoint (c->sources[i].getObjectRef(), endpoint))
+                        c->sources.setChildObject (createConstant (c->context, endpoint, value), i);
+            }
+        }
+
+        static bool isFrozenEndpoint (AST::Object& connectionEnd, const AST::EndpointDeclaration& endpoint)
+        {
+            if (auto e = AST::castToSkippingReferences<AST::EndpointDeclaration> (connectionEnd))
+                return e.get() == std::addressof (endpoint);
+
+            if (auto instance = AST::castToSkippingReferences<AST::EndpointInstance> (connectionEnd))
+                return instance->isParentEndpoint() && instance->getEndpoint (true).get() == std::addressof (endpoint);
+
+            return false;
+        }
+
+        bool pushDownIntoChild (AST::Graph& graph, const AST::EndpointDeclaration& endpoint,
+                                AST::Property& dest, const choc::value::ValueView& value)
+        {
+            auto instance = AST::castToSkippingReferences<AST::EndpointInstance> (dest);
+
+            if (instance == nullptr || instance->isParentEndpoint())
+                return false;
+
+            auto node = AST::castToSkippingReferences<AST::GraphNode> (instance->node);
+
+            if (node == nullptr || node->isArray())
+                return false;
+
+            auto childEndpoint = instance->getEndpoint (false);
+
+            if (childEndpoint == nullptr
+                 || ! canBeFrozen (*childEndpoint)
+                 || childEndpoint->isValue() != endpoint.isValue()
+                 || countConnectionsTo (graph, *node, *childEndpoint) != 1)
+                return false;
+
+            auto& processor = getProcessorOnlyUsedByNode (graph, *node);
+            freeze (processor, *processor.findEndpointWithName (childEndpoint->getName()), value);
+            return true;
+        }
+
+        static size_t countConnectionsTo (AST::Graph& graph, AST::GraphNode& node, const AST::EndpointDeclaration& endpoint)
+        {
+            size_t count = 0;
+
+            graph.visitConnections ([&] (AST::Connection& c)
+            {
+                for (auto& dest : c.dests)
+                    if (auto instance = AST::castToSkippingReferences<AST::EndpointInstance> (dest))
+                        if (instance->hasNode (node) && instance->getEndpoint (false).get() == std::addressof (endpoint))
+                            ++count;
+            });
+
+            return count;
+        }
+
+        AST::ProcessorBase& getProcessorOnlyUsedByNode (AST::Graph& graph, AST::GraphNode& node)
+        {
+            auto& processor = *node.getProcessorType();
+            size_t numUses = 0;
+
+            program.visitAllModules (true, [&] (AST::ModuleBase& m)
+            {
+                if (auto g = m.getAsGraph())
+                    for (auto& n : g->nodes.iterateAs<AST::GraphNode>())
+                        if (n.getProcessorType().get() == std::addressof (processor))
+                            ++numUses;
+            });
+
+            if (numUses <= 1)
+                return processor;
+
+            auto& clone = AST::createClonedSiblingModule (processor, false);
+            node.processorType.createReferenceTo (clone);
+
+            graph.visitObjectsInScope ([&node, &clone] (AST::Object& s)
+            {
+                if (auto e = s.getAsEndpointInstance())
+                    if (! e->node.hasDefaultValue())
+                        if (std::addressof (e->getNode()) == std::addressof (node))
+                            if (! e->endpoint.hasDefaultValue())
+                                e->endpoint.replaceWith (*clone.findEndpointWithName (e->getResolvedEndpoint().getName()));
+            });
+
+            return clone;
+        }
+
+        static bool removeConnection (AST::ListProperty& list, const AST::Connection& connection)
+        {
+            if (list.removeObject (connection))
+                return true;
+
+            for (auto& item : list)
+            {
+                if (auto connectionList = AST::castTo<AST::ConnectionList> (item))
+                    if (removeConnection (connectionList->connections, connection))
+                        return true;
+
+                if (auto connectionIf = AST::castTo<AST::ConnectionIf> (item))
+                {
+                    if (auto trueList = AST::castTo<AST::ConnectionList> (connectionIf->trueConnections))
+                        if (removeConnection (trueList->connections, connection))
+                            return true;
+
+                    if (auto falseList = AST::castTo<AST::ConnectionList> (connectionIf->falseConnections))
+                        if (removeConnection (falseList->connections, connection))
+                            return true;
+                }
+            }
+
+            return false;
+        }
+    };
+
+    if (! frozenValues.isObject() || frozenValues.size() == 0)
+        return false;
+
+    auto& mainProcessor = program.getMainProcessor();
+    EndpointFreezer freezer (program);
+
+    for (uint32_t i = 0; i < frozenValues.size(); ++i)
+    {
+        auto member = frozenValues.getObjectMemberAt (i);
+        auto endpoint = mainProcessor.findEndpointWithName (mainProcessor.getStringPool().get (member.name));
+
+        if (endpoint == nullptr || ! endpoint->isInput)
+            throwError (Errors::cannotFindEndpointToFreeze (member.name));
+
+        freezer.freeze (mainProcessor, *endpoint, member.value);
+    }
+
+    return true;
+}
+
+}
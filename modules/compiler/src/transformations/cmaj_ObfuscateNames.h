@@ -71,6 +71,7 @@ void obfuscateNames (AST::Program& p)
                 addNameToLeave (program.allocator.strings.userInitFunctionName);
                 addNameToLeave (program.allocator.strings.systemInitFunctionName);
                 addNameToLeave (program.allocator.strings.systemAdvanceFunctionName);
+                addNameToLeave (program.allocator.strings.advanceToFrameFunctionName);
                 addNameToLeave (program.allocator.strings.rootNamespaceName);
                 addNameToLeave (program.allocator.strings.consoleEndpointName);
                 addNameToLeave (program.allocator.strings.rootNamespaceName);
@@ -181,6 +181,18 @@ struct FlattenGraph
                                        *ioVariable,
                                        mainFunction->context.allocate<AST::ScopeBlock>() };
 
+            if (auto annotation = getSleepAnnotation (node); annotation != nullptr && ! useStateForIO)
+            {
+                ptr<const AST::TypeBase> counterType = graph.context.allocator.int32Type;
+
+                if (arraySize)
+                    counterType = AST::createArrayOfType (graph, graph.context.allocator.int32Type, *arraySize);
+
+                newInstance.sleepCounter = AST::createStateVariable (graph, "_sleep_" + nodeName, counterType, {});
+                newInstance.sleepThreshold = annotation->getPropertyAs<double> ("sleepThreshold", defaultSleepThreshold);
+                newInstance.framesBeforeSleeping = std::max (1, annotation->getPropertyAs<int32_t> ("sleepAfterFrames", defaultFramesBeforeSleeping));
+            }
+
             nodeInstanceInfoMap[std::addressof (node)] = std::make_unique<InstanceInfo> (std::move (newInstance));
             nodesToRender.push_back (std::addressof (node));
 
@@ -285,7 +297,12 @@ struct FlattenGraph
             for (auto& node : delayNodes)
             {
                 auto& instanceInfo = getInfoForNode (*node);
-                addRunCall (*mainFunction->getMainBlock(), *node);
+
+                if (isStreamDelayNode (*node))
+                    addStreamDelayRead (*mainFunction->getMainBlock(), *node);
+                else
+                    addRunCall (*mainFunction->getMainBlock(), *node);
+
                 instanceInfo.hasBeenRun = true;
             }
 
@@ -312,6 +329,11 @@ struct FlattenGraph
             AST::ObjectRefVector<const AST::GraphNode> delayDependencies;
             bool hasBeenRun = false;
 
+            // If the node can sleep, this counts the frames for which its outputs have been silent
+            ptr<AST::VariableDeclaration> sleepCounter;
+            double sleepThreshold = 0;
+            int32_t framesBeforeSleeping = 0;
+
             void addDependencies (const AST::Expression& source)
             {
                 if (auto expr = AST::castToSkippingReferences<const AST::ValueBase> (source))
@@ -549,6 +571,7 @@ struct FlattenGraph
                     auto& stateNodeElement = AST::createGetElement (block, stateMember, indexArgument);
 
                     addEventHandlerCall (block, *eventHandler, stateNodeElement, dest, destIndex, valueArgument);
+                    addWakeUp (block, stateArgument, dest.getNode(), AST::createVariableReference (block.context, fn.parameters.findObjectWithName (fn.getStrings().index)));
                 }
                 else
                 {
@@ -556,6 +579,7 @@ struct FlattenGraph
                     {
                         auto& stateNodeElement = AST::createGetElement (loopBlock, stateMember, index);
                         addEventHandlerCall (loopBlock, *eventHandler, stateNodeElement, dest, destIndex, valueArgument);
+                        addWakeUp (loopBlock, stateArgument, dest.getNode(), index);
                     });
                 }
             }
@@ -564,7 +588,14 @@ struct FlattenGraph
                 ref<AST::ValueBase> nodeState = stateMember;
 
                 if (auto getElement = AST::castToSkippingReferences<AST::GetElement> (dest.node))
+                {
                     nodeState = AST::createGetElement (block, stateMember, getElement->getSingleIndex());
+                    addWakeUp (block, stateArgument, dest.getNode(), getElement->getSingleIndex());
+                }
+                else
+                {
+                    addWakeUp (block, stateArgument, dest.getNode(), {});
+                }
 
                 if (destEndpointIsArray && destIndex == nullptr && sourceIndex == nullptr && sourceIsArray)
                 {
@@ -608,7 +639,236 @@ struct FlattenGraph
 
             mainFunction->getMainBlock()->addStatement (*instanceInfo.steps);
 
-            addRunCall (*mainFunction->getMainBlock(), node);
+            if (isStreamDelayNode (node))
+                addStreamDelayWrite (*mainFunction->getMainBlock(), node);
+            else if (instanceInfo.sleepCounter != nullptr)
+                addRunCallWithSleepCheck (*mainFunction->getMainBlock(), node);
+            else
+                addRunCall (*mainFunction->getMainBlock(), node);
+        }
+
+        //==============================================================================
+        // A delay node is run twice per frame: once at the start to produce its output, and again
+        // once its input is known. For a std::intrinsics::delay::StreamDelay, calling its main()
+        // means resuming its state machine each time, so instead we read and write its ring buffer
+        // directly. The node's state keeps the same layout, so its initialisation is unchanged.
+        static bool isStreamDelayNode (const AST::GraphNode& node)
+        {
+            if (! isDelayNode (node) || node.getArraySize())
+                return false;
+
+            auto output = node.getProcessorType()->findEndpointWithName (node.getStrings().out);
+
+            // array frame types are left alone, as their buffer may have been flattened into one dimension
+            return output != nullptr && output->isStream()
+                    && ! output->getDataTypes()[0]->skipConstAndRefModifiers().isArray();
+        }
+
+        AST::ValueBase& getStreamDelayStateMember (AST::ScopeBlock& block, const AST::GraphNode& node, std::string_view member)
+        {
+            return AST::createGetStructMember (block, getInfoForNode (node).stateVariable.get(), member);
+        }
+
+        AST::ValueBase& getStreamDelayIOMember (AST::ScopeBlock& block, const AST::GraphNode& node, AST::PooledString endpointName)
+        {
+            auto endpoint = node.getProcessorType()->findEndpointWithName (endpointName);
+            return AST::createGetStructMember (block, getInfoForNode (node).ioVariable.get(), StreamUtilities::getEndpointStateMemberName (*endpoint));
+        }
+
+        void addStreamDelayRead (AST::ScopeBlock& block, const AST::GraphNode& node)
+        {
+            AST::addAssignment (block,
+                                getStreamDelayIOMember (block, node, node.getStrings().out),
+                                AST::createGetElement (block, getStreamDelayStateMember (block, node, "buffer"),
+                                                       getStreamDelayStateMember (block, node, "pos")));
+        }
+
+        void addStreamDelayWrite (AST::ScopeBlock& block, const AST::GraphNode& node)
+        {
+            auto& processorType = *node.getProcessorType();
+            auto stateType = processorType.findStruct (processorType.getStrings().stateStructName);
+            CMAJ_ASSERT (stateType != nullptr);
+
+            auto bufferType = stateType->getTypeForMember (std::string_view ("buffer"));
+            CMAJ_ASSERT (bufferType != nullptr && bufferType->isArray());
+            auto delayLength = static_cast<int32_t> (bufferType->getArrayOrVectorSize (0));
+
+            AST::addAssignment (block,
+                                AST::createGetElement (block, getStreamDelayStateMember (block, node, "buffer"),
+                                                       getStreamDelayStateMember (block, node, "pos")),
+                                getStreamDelayIOMember (block, node, node.getStrings().in));
+
+            // The wrap<> type of the position has already been replaced by an int by this stage
+            block.addStatement (AST::createPreInc (block.context, getStreamDelayStateMember (block, node, "pos")));
+
+            block.addStatement (AST::createIfStatement (block.context,
+                                                        AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::equals,
+                                                                             getStreamDelayStateMember (block, node, "pos"),
+                                                                             block.context.allocator.createConstantInt32 (delayLength)),
+                                                        AST::createAssignment (block.context,
+                                                                               getStreamDelayStateMember (block, node, "pos"),
+                                                                               block.context.allocator.createConstantInt32 (0))));
+        }
+
+        //==============================================================================
+        // A processor marked with [[ sleepWhenSilent ]] stops being run once all its stream outputs
+        // have stayed within +/- sleepThreshold for sleepAfterFrames frames, and is woken again by a
+        // stream input going outside that range, or by an event arriving. While it sleeps its outputs
+        // are silent and its state is frozen, so this is only safe for processors which can resume
+        // like that, e.g. voices with decaying envelopes or effects with a finite tail.
+        static constexpr double  defaultSleepThreshold = 1.0e-5;
+        static constexpr int32_t defaultFramesBeforeSleeping = 1024;
+
+        static ptr<const AST::Annotation> getSleepAnnotation (const AST::GraphNode& node)
+        {
+            auto processorType = node.getProcessorType();
+            auto annotation = AST::castTo<AST::Annotation> (processorType->annotation);
+
+            if (annotation == nullptr || ! annotation->getBoolFlag ("sleepWhenSilent")
+                 || isDelayNode (node) || processorType->findMainFunction() == nullptr)
+                return {};
+
+            bool hasStreamOutput = false;
+
+            // The silence checks can only look at non-array streams of floats or float vectors
+            for (auto& endpoint : processorType->getAllEndpoints())
+            {
+                if (endpoint->isStream())
+                {
+                    auto& type = endpoint->getDataTypes()[0]->skipConstAndRefModifiers();
+
+                    if (endpoint->isArray() || ! type.isFloatOrVectorOfFloat())
+                        return {};
+
+                    if (endpoint->isOutput())
+                        hasStreamOutput = true;
+                }
+            }
+
+            if (! hasStreamOutput)
+                return {};
+
+            return annotation;
+        }
+
+        void addRunCallWithSleepCheck (AST::ScopeBlock& block, const AST::GraphNode& node)
+        {
+            auto& instanceInfo = getInfoForNode (node);
+            auto& processorType = *node.getProcessorType();
+            auto processorMainFunction = processorType.findMainFunction();
+
+            auto addChecks = [&] (AST::ScopeBlock& b, ptr<AST::ValueBase> index)
+            {
+                ref<AST::ValueBase> stateVariable = instanceInfo.stateVariable;
+                ref<AST::ValueBase> ioVariable = instanceInfo.ioVariable;
+
+                if (index != nullptr)
+                {
+                    stateVariable = AST::createGetElement (b, instanceInfo.stateVariable, *index, true);
+                    ioVariable = AST::createGetElement (b, instanceInfo.ioVariable, *index, true);
+                }
+
+                auto getCounter = [&]() -> AST::ValueBase&
+                {
+                    auto& counter = AST::createVariableReference (b.context, *instanceInfo.sleepCounter);
+
+                    if (index != nullptr)
+                        return AST::createGetElement (b, counter, *index, true);
+
+                    return counter;
+                };
+
+                auto& zero = b.context.allocator.createConstantInt32 (0);
+
+                if (auto inputIsActive = createActivityCheck (b, ioVariable, processorType.getInputEndpoints (false), instanceInfo.sleepThreshold))
+                    b.addStatement (AST::createIfStatement (b.context, *inputIsActive, AST::createAssignment (b.context, getCounter(), zero)));
+
+                auto& runBlock = b.allocateChild<AST::ScopeBlock>();
+                addRunCall (runBlock, processorMainFunction, stateVariable, ioVariable);
+
+                auto outputIsActive = createActivityCheck (runBlock, ioVariable, processorType.getOutputEndpoints (false), instanceInfo.sleepThreshold);
+                CMAJ_ASSERT (outputIsActive != nullptr);
+
+                runBlock.addStatement (AST::createIfStatement (runBlock.context, *outputIsActive,
+                                                               AST::createAssignment (runBlock.context, getCounter(), b.context.allocator.createConstantInt32 (0)),
+                                                               AST::createPreInc (runBlock.context, getCounter())));
+
+                auto& isAwake = AST::createBinaryOp (b, AST::BinaryOpTypeEnum::Enum::lessThan, getCounter(),
+                                                     b.context.allocator.createConstantInt32 (instanceInfo.framesBeforeSleeping));
+
+                b.addStatement (AST::createIfStatement (b.context, isAwake, runBlock));
+            };
+
+            if (auto arraySize = node.getArraySize())
+                addLoop (block, *arraySize, [&] (AST::ScopeBlock& loopBlock, AST::ValueBase& index) { addChecks (loopBlock, index); });
+            else
+                addChecks (block, {});
+        }
+
+        // Returns an expression which is true if any element of the given stream endpoints lies outside +/- threshold
+        static ptr<AST::ValueBase> createActivityCheck (AST::ScopeBlock& block, AST::ValueBase& ioVariable,
+                                                        const AST::ObjectRefVector<const AST::EndpointDeclaration>& endpoints,
+                                                        double threshold)
+        {
+            ptr<AST::ValueBase> result;
+
+            for (auto& endpoint : endpoints)
+            {
+                if (! endpoint->isStream())
+                    continue;
+
+                auto& type = endpoint->getDataTypes()[0]->skipConstAndRefModifiers();
+                auto memberName = StreamUtilities::getEndpointStateMemberName (*endpoint);
+                auto numElements = type.isVector() ? static_cast<int32_t> (type.getVectorSize()) : 1;
+                auto is64Bit = type.isVector() ? type.getArrayOrVectorElementType()->isPrimitiveFloat64() : type.isPrimitiveFloat64();
+
+                for (int32_t i = 0; i < numElements; ++i)
+                {
+                    auto getElement = [&]() -> AST::ValueBase&
+                    {
+                        auto& member = AST::createGetStructMember (block, ioVariable, memberName);
+
+                        if (type.isVector())
+                            return AST::createGetElement (block, member, i);
+
+                        return member;
+                    };
+
+                    auto getLimit = [&] (double limit) -> AST::ValueBase&
+                    {
+                        if (is64Bit)
+                            return block.context.allocator.createConstantFloat64 (limit);
+
+                        return block.context.allocator.createConstantFloat32 (static_cast<float> (limit));
+                    };
+
+                    auto& isActive = AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::logicalOr,
+                                                          AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::greaterThan, getElement(), getLimit (threshold)),
+                                                          AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::lessThan, getElement(), getLimit (-threshold)));
+
+                    if (result == nullptr)
+                        result = isActive;
+                    else
+                        result = AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::logicalOr, *result, isActive);
+                }
+            }
+
+            return result;
+        }
+
+        void addWakeUp (AST::ScopeBlock& block, AST::ValueBase& stateArgument, const AST::GraphNode& node, ptr<AST::Object> nodeIndex)
+        {
+            auto& instanceInfo = getInfoForNode (node);
+
+            if (instanceInfo.sleepCounter == nullptr)
+                return;
+
+            ref<AST::ValueBase> counter = AST::createGetStructMember (block, stateArgument, instanceInfo.sleepCounter->getName().get());
+
+            if (nodeIndex != nullptr)
+                counter = AST::createGetElement (block, counter, *nodeIndex, true);
+
+            AST::addAssignment (block, counter, block.context.allocator.createConstantInt32 (0));
         }
 
         AST::ValueBase& getStructMember (ptr<AST::ScopeBlock> block,
@@ -680,16 +940,52 @@ struct FlattenGraph
 
             addLoop (block, itemsToCopy, [&] (AST::ScopeBlock& loopBlock, AST::ValueBase& index)
             {
-                auto& sourceMember = getStructMember (loopBlock, source, getIndexValue (sourceIndex, index), true);
+                auto& sourceIndexValue = getIndexValue (sourceIndex, index);
+                ptr<AST::ScopeBlock> writeBlock = loopBlock;
+
+                if (auto sourceIsAwake = createSourceIsAwakeCheck (loopBlock, source, sourceIndexValue, dest))
+                {
+                    auto& awakeBlock = loopBlock.allocateChild<AST::ScopeBlock>();
+                    loopBlock.addStatement (AST::createIfStatement (loopBlock.context, *sourceIsAwake, awakeBlock));
+                    writeBlock = awakeBlock;
+                }
+
+                auto& sourceMember = getStructMember (writeBlock, source, sourceIndexValue, true);
 
                 if (dest.isParentEndpoint())
-                    writeToEndpoint (loopBlock, dest, getIndexValue (destIndex, index), sourceMember);
+                    writeToEndpoint (writeBlock, dest, getIndexValue (destIndex, index), sourceMember);
                 else
-                    writeToStructMember (loopBlock, getStructMember (loopBlock, dest, getIndexValue (destIndex, index), false),
+                    writeToStructMember (writeBlock, getStructMember (writeBlock, dest, getIndexValue (destIndex, index), false),
                                          sourceMember, dest.getEndpoint (false)->isValue());
             });
         }
 
+        // A sleeping node's stream outputs are silent, so a stream connection from it has nothing to add
+        // to its destination. This returns a check for whether the source node is awake, or nullptr if
+        // it can't sleep. A node whose outputs have only just dropped below its threshold is treated as
+        // asleep a frame early, which is inaudible by the same reasoning that lets it sleep at all.
+        ptr<AST::ValueBase> createSourceIsAwakeCheck (AST::ScopeBlock& block, AST::EndpointInstance& source,
+                                                      AST::ValueBase& sourceIndex, AST::EndpointInstance& dest)
+        {
+            if (source.isParentEndpoint() || ! dest.getEndpoint (false)->isStream())
+                return {};
+
+            auto& instanceInfo = getInfoForNode (source.getNode());
+
+            if (instanceInfo.sleepCounter == nullptr)
+                return {};
+
+            ref<AST::ValueBase> counter = AST::createVariableReference (block.context, *instanceInfo.sleepCounter);
+
+            if (auto nodeIndex = getNodeIndex (source))
+                counter = AST::createGetElement (block, counter, *nodeIndex);
+            else if (getGraphNodeArraySize (source))
+                counter = AST::createGetElement (block, counter, sourceIndex, true);
+
+            return AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::lessThan, counter.get(),
+                                        block.context.allocator.createConstantInt32 (instanceInfo.framesBeforeSleeping));
+        }
+
         AST::ValueBase& getSourceItem (ptr<AST::ScopeBlock> block, AST::ValueBase& v, AST::ValueBase& index)
         {
             if (! v.getResultType()->isArray())
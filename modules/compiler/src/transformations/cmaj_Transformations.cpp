@@ -57,51 +57,37 @@
 #include "cmaj_AddFallbackIntrinsics.h"
 #include "cmaj_ReplaceMultidimensionalArrays.h"
 #include "cmaj_ConvertLargeConstants.h"
+#include "cmaj_FreezeInputEndpoints.h"
 
 namespace cmaj::transformations
 {
 
-static void runResolutionPasses (AST::Program& program, bool throwOnErrors)
+static void runResolutionPasses (AST::Program& program, bool throwOnErrors, bool revisitAllModules = false)
 {
-    for (;;)
-    {
-        passes::PassResult result;
-
-        result += passes::runPass<passes::TypeResolver>             (program, throwOnErrors);
-        result += passes::runPass<passes::FunctionResolver>         (program, throwOnErrors);
-        result += passes::runPass<passes::NameResolver>             (program, throwOnErrors);
-        result += passes::runPass<passes::ModuleSpecialiser>        (program, throwOnErrors);
-        result += passes::runPass<passes::ProcessorResolver>        (program, throwOnErrors);
-        result += passes::runPass<passes::EndpointResolver>         (program, throwOnErrors);
-        result += passes::runPass<passes::ConstantFolder>           (program, throwOnErrors);
-        result += passes::runPass<passes::StrengthReduction>        (program, throwOnErrors);
-        result += passes::runPass<passes::ExternalResolver>         (program, throwOnErrors);
-
-        if (result.numChanges == 0)
-            return;
-    }
+    passes::ResolutionPassManager (program).run (throwOnErrors, revisitAllModules);
 }
 
-static void runFullResolutionAndChecks (AST::Program& program, uint64_t stackSizeLimit, bool allowTopLevelSlices, bool allowExternalFunctions)
+static void runFullResolutionAndChecks (AST::Program& program, uint64_t stackSizeLimit, bool allowTopLevelSlices, bool allowExternalFunctions,
+                                        bool revisitAllModules = false)
 {
-    runResolutionPasses (program, false);
+    runResolutionPasses (program, false, revisitAllModules);
     passes::DuplicateNameCheckPass::check (program);
-    runResolutionPasses (program, true);
+    runResolutionPasses (program, true, revisitAllModules);
 
     validation::PostLink::check (program, stackSizeLimit, allowTopLevelSlices, allowExternalFunctions);
 }
 
-void runBasicResolutionPasses (AST::Program& program)
+void runBasicResolutionPasses (AST::Program& program, bool revisitAllModules)
 {
-    runResolutionPasses (program, false);
+    runResolutionPasses (program, false, revisitAllModules);
 }
 
-void prepareForResolution (AST::Program& program, uint64_t stackSizeLimit)
+void prepareForResolution (AST::Program& program, uint64_t stackSizeLimit, bool revisitAllModules)
 {
-    runResolutionPasses (program, false);
+    runResolutionPasses (program, false, revisitAllModules);
 
     if (! validation::PostLoad::check (program))
-        runFullResolutionAndChecks (program, stackSizeLimit, false, true);
+        runFullResolutionAndChecks (program, stackSizeLimit, false, true, revisitAllModules);
 
     createHoistedEndpointConnections (program);
 }
@@ -118,19 +104,25 @@ void prepareForCodeGen (AST::Program& program,
 {
     CMAJ_ASSERT (buildSettings.getMaxBlockSize() != 0 && buildSettings.getEventBufferSize() != 0);
 
+    auto revisitAllModules = buildSettings.shouldUseFullResolutionPasses();
+
     cloneGraphNodes (program);
 
     auto processorReplacementState = replaceProcessorProperties (program, buildSettings.getMaxFrequency(), buildSettings.getFrequency(), useDynamicSampleRate);
 
     while (processorReplacementState.propertiesReplaced != 0)
     {
-        runFullResolutionAndChecks (program, buildSettings.getMaxStackSize(), allowTopLevelSlices, allowExternalFunctions);
+        runFullResolutionAndChecks (program, buildSettings.getMaxStackSize(), allowTopLevelSlices, allowExternalFunctions, revisitAllModules);
         processorReplacementState = replaceProcessorProperties (program, buildSettings.getMaxFrequency(), buildSettings.getFrequency(), useDynamicSampleRate);
     }
 
-    runFullResolutionAndChecks (program, buildSettings.getMaxStackSize(), allowTopLevelSlices, allowExternalFunctions);
+    runFullResolutionAndChecks (program, buildSettings.getMaxStackSize(), allowTopLevelSlices, allowExternalFunctions, revisitAllModules);
     simplifyGraphConnections (program);
-    runResolutionPasses (program, allowTopLevelSlices);
+
+    if (freezeInputEndpoints (program, buildSettings.getFrozenEndpointValues()))
+        runFullResolutionAndChecks (program, buildSettings.getMaxStackSize(), allowTopLevelSlices, allowExternalFunctions, revisitAllModules);
+
+    runResolutionPasses (program, allowTopLevelSlices, revisitAllModules);
 
     resultLatency = program.getMainProcessor().getLatency();
 
@@ -138,7 +130,8 @@ void prepareForCodeGen (AST::Program& program,
     removeUnusedNodes (program);
     removeGenericAndParameterisedObjects (program);
     removeUnusedEndpoints (program, isEndpointActive);
-    runResolutionPasses (program, allowTopLevelSlices);
+    addSparseStreamSupport (program);
+    runResolutionPasses (program, allowTopLevelSlices, revisitAllModules);
     convertComplexTypes (program);
     addFallbackIntrinsics (program, engineSupportsIntrinsic);
     canonicaliseLoopsAndBlocks (program);
@@ -25,7 +25,8 @@ namespace cmaj::transformations
     /// to have its sample rate and other processor properties set, and for its endpoints
     /// and externals to be queried and their values resolved.
     void prepareForResolution (AST::Program&,
-                               uint64_t stackSizeLimit);
+                               uint64_t stackSizeLimit,
+                               bool revisitAllModules = false);
 
     /// After resolving the program, this does a full validity check, flattens any graphs and
     /// runs transformations to lower its structure to a simpler subset of the AST that's
@@ -47,7 +48,7 @@ namespace cmaj::transformations
 
     /// Runs a set of basic simplification and resolution passes, ignoring errors
     /// and stopping when it runs out of things to change.
-    void runBasicResolutionPasses (AST::Program&);
+    void runBasicResolutionPasses (AST::Program&, bool revisitAllModules = false);
 
     /// Recursively finds child namespaces with the same name and merges them
     void mergeDuplicateNamespaces (AST::Namespace& parentNamespace);
@@ -55,12 +56,17 @@ namespace cmaj::transformations
     /// Blanks-out the names of any internal symbols in this program
     void obfuscateNames (AST::Program&);
 
-    /// Store a set of top-level AST objects as a binary module
-    std::vector<uint8_t> createBinaryModule (const AST::ObjectRefVector<AST::ModuleBase>& objects);
+    /// Store a set of top-level AST objects as a binary module. If a source file is given,
+    /// the objects' code locations are stored as offsets into it.
+    std::vector<uint8_t> createBinaryModule (const AST::ObjectRefVector<AST::ModuleBase>& objects,
+                                             const SourceFile* sourceForLocations = nullptr);
 
-    /// Reloads a set of objects from a binary module that was created with createBinaryModule()
+    /// Reloads a set of objects from a binary module that was created with createBinaryModule().
+    /// If the module was written with locations, the same source file (or an identical copy
+    /// of it) must be passed in here.
     AST::ObjectRefVector<AST::ModuleBase> parseBinaryModule (AST::Allocator&, const void*, size_t,
-                                                             bool checkHashValidity = true);
+                                                             bool checkHashValidity = true,
+                                                             const SourceFile* sourceForLocations = nullptr);
 
     /// Checks whether this seems to be a valid chunk of module data
     bool isValidBinaryModuleData (const void*, size_t);
@@ -121,6 +121,12 @@ struct PerformerAllocationCheckWrapper  : public choc::com::ObjectWithAtomicRefC
         return target->addInputEvent (endpoint, typeIndex, eventData);
     }
 
+    Result addInputEventAtFrame (EndpointHandle endpoint, uint32_t typeIndex, const void* eventData, uint32_t frameOffset) override
+    {
+        ScopedAllocationTracker allocationTracker;
+        return target->addInputEventAtFrame (endpoint, typeIndex, eventData, frameOffset);
+    }
+
     Result copyOutputValue (EndpointHandle h, void* dest) override
     {
         ScopedAllocationTracker allocationTracker;
@@ -154,6 +160,12 @@ struct PerformerAllocationCheckWrapper  : public choc::com::ObjectWithAtomicRefC
         ScopedAllocationTracker allocationTracker;
         return target->advance();
     }
+
+    Result processBlock (uint32_t numFrames, const void* const* inputData, void* const* outputData) override
+    {
+        ScopedAllocationTracker allocationTracker;
+        return target->processBlock (numFrames, inputData, outputData);
+    }
 };
 
 cmaj::PerformerPtr createAllocationCheckingPerformerWrapper (cmaj::PerformerPtr source)
@@ -33,6 +33,10 @@
  #include <unistd.h>
 #endif
 
+#ifdef CHOC_APPLE
+ #include <mach/mach.h>
+#endif
+
 
 //==============================================================================
 namespace cmaj::test
@@ -461,6 +465,7 @@ namespace cmaj::test
             CMAJ_JAVASCRIPT_BINDING_METHOD (getCurrentTestSection)
             CMAJ_JAVASCRIPT_BINDING_METHOD (getDefaultEngineOptions)
             CMAJ_JAVASCRIPT_BINDING_METHOD (getEngineName)
+            CMAJ_JAVASCRIPT_BINDING_METHOD (getResidentMemoryUsage)
             CMAJ_JAVASCRIPT_BINDING_METHOD (testReportFail)
             CMAJ_JAVASCRIPT_BINDING_METHOD (testReportSuccess)
             CMAJ_JAVASCRIPT_BINDING_METHOD (testReportDisabled)
@@ -578,6 +583,33 @@ namespace cmaj::test
             return choc::value::createString (javascriptEngine->getEngineTypeName());
         }
 
+        /// Returns the process's resident memory size in bytes, or 0 if this
+        /// isn't available on the current platform
+        choc::value::Value getResidentMemoryUsage (choc::javascript::ArgumentList)
+        {
+            int64_t bytes = 0;
+
+           #if defined (CHOC_LINUX)
+            if (auto statm = std::fopen ("/proc/self/statm", "r"))
+            {
+                long totalPages = 0, residentPages = 0;
+
+                if (std::fscanf (statm, "%ld %ld", &totalPages, &residentPages) == 2)
+                    bytes = static_cast<int64_t> (residentPages) * static_cast<int64_t> (sysconf (_SC_PAGESIZE));
+
+                std::fclose (statm);
+            }
+           #elif defined (CHOC_APPLE)
+            mach_task_basic_info info;
+            mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+            if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t> (&info), &count) == KERN_SUCCESS)
+                bytes = static_cast<int64_t> (info.resident_size);
+           #endif
+
+            return choc::value::createInt64 (bytes);
+        }
+
         std::string getErrorString (choc::javascript::ArgumentList args, size_t index)
         {
             if (auto value = args[index])
@@ -954,6 +986,7 @@ function TestSection (ts)
 function getCurrentTestSection()                     { return new TestSection (_getCurrentTestSection()); }
 function getDefaultEngineOptions()                   { return _getDefaultEngineOptions(); }
 function getEngineName()                             { return _getEngineName(); }
+function getResidentMemoryUsage()                    { return _getResidentMemoryUsage(); }
 )WRAPPER_SCRIPT";
         }
 
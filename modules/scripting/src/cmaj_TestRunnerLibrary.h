@@ -617,11 +617,13 @@ static constexpr std::string_view testFunctionLibrary = "//\n"
     "//==============================================================================\n"
     "/*\n"
     "    This test builds a processor and renders a given amount of data through it,\n"
-    "    measuring and reporting its performance.\n"
+    "    measuring and reporting its performance. If the optional 'resets' property is\n"
+    "    given, it also reports the average time taken by that many calls to reset().\n"
     "\n"
     "    e.g.\n"
     "    ## performanceTest ({ frequency:44100, minBlockSize:4, maxBlockSize: 1024, samplesToRender:100000 })\n"
     "    ## performanceTest ({ frequency:44100, minBlockSize:4, maxBlockSize: 1024, samplesToRender:100000, patch: \"testPatch.cmajorpatch\" })\n"
+    "    ## performanceTest ({ frequency:44100, minBlockSize:4, maxBlockSize: 1024, samplesToRender:100000, resets:100 })\n"
     "*/\n"
     "\n"
     "function performanceTest (options)\n"
@@ -710,6 +712,90 @@ static constexpr std::string_view testFunctionLibrary = "//\n"
     "        blockSize *= 2;\n"
     "    }\n"
     "\n"
+    "    if (options.resets != undefined)\n"
+    "    {\n"
+    "        let resetTime = performer.calculateResetPerformance (options.resets);\n"
+    "\n"
+    "        if (isError (resetTime))\n"
+    "        {\n"
+    "            testSection.reportFail (resetTime);\n"
+    "            return;\n"
+    "        }\n"
+    "\n"
+    "        testSection.logMessage (\"Reset time: \" + (resetTime * 1000000).toFixed (1) + \" us (average of \" + options.resets + \" resets)\");\n"
+    "    }\n"
+    "\n"
+    "    testSection.reportSuccess();\n"
+    "}\n"
+    "\n"
+    "//==============================================================================\n"
+    "/*\n"
+    "    This test builds and links a number of instances of the same processor, all\n"
+    "    kept loaded at the same time, and reports the link time and the growth in\n"
+    "    the process's memory usage per instance.\n"
+    "\n"
+    "    e.g.\n"
+    "    ## multiInstanceLinkTest ({ frequency:44100, blockSize:512, instances:200 })\n"
+    "*/\n"
+    "\n"
+    "function multiInstanceLinkTest (options)\n"
+    "{\n"
+    "    let testSection = getCurrentTestSection();\n"
+    "\n"
+    "    if (getEngineName() == \"webview\")\n"
+    "    {\n"
+    "        testSection.reportUnsupported (\"engine type \" + getEngineName() + \" not supported\");\n"
+    "        return;\n"
+    "    }\n"
+    "\n"
+    "    let numInstances = (options.instances != undefined) ? options.instances : 100;\n"
+    "    let engines = [], performers = [];\n"
+    "    let totalLinkTime = 0;\n"
+    "    let initialMemory = getResidentMemoryUsage();\n"
+    "\n"
+    "    for (let i = 0; i < numInstances; i++)\n"
+    "    {\n"
+    "        let timingInfo = {};\n"
+    "        let engine = buildEngineWithLoadedProgram (testSection, options, timingInfo);\n"
+    "\n"
+    "        if (isError (engine, options))\n"
+    "        {\n"
+    "            testSection.reportFail (engine);\n"
+    "            return;\n"
+    "        }\n"
+    "\n"
+    "        let linkTime = engine.link();\n"
+    "\n"
+    "        if (isError (linkTime, options))\n"
+    "        {\n"
+    "            testSection.reportFail (linkTime);\n"
+    "            return;\n"
+    "        }\n"
+    "\n"
+    "        totalLinkTime += linkTime;\n"
+    "        engines.push (engine);\n"
+    "        performers.push (engine.createPerformer());\n"
+    "    }\n"
+    "\n"
+    "    testSection.logMessage (\"Instances       : \" + numInstances);\n"
+    "    testSection.logMessage (\"Total link time : \" + Math.round (totalLinkTime * 1000) + \" ms\");\n"
+    "    testSection.logMessage (\"Mean link time  : \" + (totalLinkTime * 1000 / numInstances).toFixed (2) + \" ms\");\n"
+    "\n"
+    "    let finalMemory = getResidentMemoryUsage();\n"
+    "\n"
+    "    if (initialMemory > 0 && finalMemory > 0)\n"
+    "    {\n"
+    "        let growth = finalMemory - initialMemory;\n"
+    "        testSection.logMessage (\"Memory growth   : \" + (growth / (1024 * 1024)).toFixed (1) + \" MB\");\n"
+    "        testSection.logMessage (\"Per instance    : \" + (growth / (1024 * numInstances)).toFixed (1) + \" KB\");\n"
+    "    }\n"
+    "\n"
+    "    for (let i = 0; i < performers.length; i++)\n"
+    "        performers[i].release();\n"
+    "\n"
+    "    for (let i = 0; i < engines.length; i++)\n"
+    "        engines[i].release();\n"
+    "\n"
     "    testSection.reportSuccess();\n"
     "}\n"
     "\n"
@@ -1247,6 +1333,10 @@ static constexpr std::string_view testFunctionLibrary = "//\n"
     "        if (options.sessionID !== undefined)          buildSettings.sessionID = options.sessionID;\n"
     "        if (options.optimisationLevel !== undefined)  buildSettings.optimisationLevel = options.optimisationLevel;\n"
     "        if (options.mainProcessor !== undefined)      buildSettings.mainProcessor = options.mainProcessor;\n"
+    "        if (options.codeGenThreads !== undefined)     buildSettings.codeGenThreads = options.codeGenThreads;\n"
+    "        if (options.mathsAccuracy !== undefined)      buildSettings.mathsAccuracy = options.mathsAccuracy;\n"
+    "        if (options.frozenEndpoints !== undefined)    buildSettings.frozenEndpoints = options.frozenEndpoints;\n"
+    "        if (options.fullResolutionPasses !== undefined) buildSettings.fullResolutionPasses = options.fullResolutionPasses;\n"
     "    }\n"
     "\n"
     "    engine.setBuildSettings (buildSettings);\n"
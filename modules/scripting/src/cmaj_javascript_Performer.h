@@ -107,6 +107,7 @@ struct PerformerLibrary
         CMAJ_JAVASCRIPT_BINDING_METHOD (performerAddInputEvent)
         CMAJ_JAVASCRIPT_BINDING_METHOD (performerGetXRuns)
         CMAJ_JAVASCRIPT_BINDING_METHOD (performerCalculateRenderPerformance)
+        CMAJ_JAVASCRIPT_BINDING_METHOD (performerCalculateResetPerformance)
     }
 
     void reset()
@@ -357,6 +358,21 @@ private:
             return choc::value::Value (elapsed.count());
         }
 
+        choc::value::Value calculateResetPerformance (choc::javascript::ArgumentList args)
+        {
+            auto numResets = std::max (1u, args.get<uint32_t> (1));
+
+            auto startTime = std::chrono::steady_clock::now();
+
+            for (uint32_t i = 0; i < numResets; ++i)
+                performer.reset();
+
+            auto endTime = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed = endTime - startTime;
+
+            return choc::value::Value (elapsed.count() / numResets);
+        }
+
         static cmaj::EndpointHandle getEndpointHandle (choc::javascript::ArgumentList args, size_t index)
         {
             if (auto data = args[index])
@@ -919,6 +935,14 @@ private:
         return createErrorObject ("Cannot find performer");
     }
 
+    choc::value::Value performerCalculateResetPerformance (choc::javascript::ArgumentList args)
+    {
+        if (auto performer = getPerformer (args))
+            return performer->calculateResetPerformance (args);
+
+        return createErrorObject ("Cannot find performer");
+    }
+
     //==============================================================================
     static std::string getWrapperScript()
     {
@@ -1032,6 +1056,7 @@ class Performer
     addInputEvent (h, d)                { return _performerAddInputEvent (this.id, h, d); }
     getXRuns()                          { return _performerGetXRuns (this.id); }
     calculateRenderPerformance (bs, f)  { return _performerCalculateRenderPerformance (this.id, bs, f); }
+    calculateResetPerformance (n)       { return _performerCalculateResetPerformance (this.id, n); }
 }
 
 class Program
@@ -613,11 +613,13 @@ function testConsole (expectedConsoleMsg, options)
 //==============================================================================
 /*
     This test builds a processor and renders a given amount of data through it,
-    measuring and reporting its performance.
+    measuring and reporting its performance. If the optional 'resets' property is
+    given, it also reports the average time taken by that many calls to reset().
 
     e.g.
     ## performanceTest ({ frequency:44100, minBlockSize:4, maxBlockSize: 1024, samplesToRender:100000 })
     ## performanceTest ({ frequency:44100, minBlockSize:4, maxBlockSize: 1024, samplesToRender:100000, patch: "testPatch.cmajorpatch" })
+    ## performanceTest ({ frequency:44100, minBlockSize:4, maxBlockSize: 1024, samplesToRender:100000, resets:100 })
 */
 
 function performanceTest (options)
@@ -706,6 +708,90 @@ function performanceTest (options)
         blockSize *= 2;
     }
 
+    if (options.resets != undefined)
+    {
+        let resetTime = performer.calculateResetPerformance (options.resets);
+
+        if (isError (resetTime))
+        {
+            testSection.reportFail (resetTime);
+            return;
+        }
+
+        testSection.logMessage ("Reset time: " + (resetTime * 1000000).toFixed (1) + " us (average of " + options.resets + " resets)");
+    }
+
+    testSection.reportSuccess();
+}
+
+//==============================================================================
+/*
+    This test builds and links a number of instances of the same processor, all
+    kept loaded at the same time, and reports the link time and the growth in
+    the process's memory usage per instance.
+
+    e.g.
+    ## multiInstanceLinkTest ({ frequency:44100, blockSize:512, instances:200 })
+*/
+
+function multiInstanceLinkTest (options)
+{
+    let testSection = getCurrentTestSection();
+
+    if (getEngineName() == "webview")
+    {
+        testSection.reportUnsupported ("engine type " + getEngineName() + " not supported");
+        return;
+    }
+
+    let numInstances = (options.instances != undefined) ? options.instances : 100;
+    let engines = [], performers = [];
+    let totalLinkTime = 0;
+    let initialMemory = getResidentMemoryUsage();
+
+    for (let i = 0; i < numInstances; i++)
+    {
+        let timingInfo = {};
+        let engine = buildEngineWithLoadedProgram (testSection, options, timingInfo);
+
+        if (isError (engine, options))
+        {
+            testSection.reportFail (engine);
+            return;
+        }
+
+        let linkTime = engine.link();
+
+        if (isError (linkTime, options))
+        {
+            testSection.reportFail (linkTime);
+            return;
+        }
+
+        totalLinkTime += linkTime;
+        engines.push (engine);
+        performers.push (engine.createPerformer());
+    }
+
+    testSection.logMessage ("Instances       : " + numInstances);
+    testSection.logMessage ("Total link time : " + Math.round (totalLinkTime * 1000) + " ms");
+    testSection.logMessage ("Mean link time  : " + (totalLinkTime * 1000 / numInstances).toFixed (2) + " ms");
+
+    let finalMemory = getResidentMemoryUsage();
+
+    if (initialMemory > 0 && finalMemory > 0)
+    {
+        let growth = finalMemory - initialMemory;
+        testSection.logMessage ("Memory growth   : " + (growth / (1024 * 1024)).toFixed (1) + " MB");
+        testSection.logMessage ("Per instance    : " + (growth / (1024 * numInstances)).toFixed (1) + " KB");
+    }
+
+    for (let i = 0; i < performers.length; i++)
+        performers[i].release();
+
+    for (let i = 0; i < engines.length; i++)
+        engines[i].release();
+
     testSection.reportSuccess();
 }
 
@@ -1243,6 +1329,10 @@ function updateBuildSettings (engine, defaultFrequency, defaultBlockSize, ignore
         if (options.sessionID !== undefined)          buildSettings.sessionID = options.sessionID;
         if (options.optimisationLevel !== undefined)  buildSettings.optimisationLevel = options.optimisationLevel;
         if (options.mainProcessor !== undefined)      buildSettings.mainProcessor = options.mainProcessor;
+        if (options.codeGenThreads !== undefined)     buildSettings.codeGenThreads = options.codeGenThreads;
+        if (options.mathsAccuracy !== undefined)      buildSettings.mathsAccuracy = options.mathsAccuracy;
+        if (options.frozenEndpoints !== undefined)    buildSettings.frozenEndpoints = options.frozenEndpoints;
+        if (options.fullResolutionPasses !== undefined) buildSettings.fullResolutionPasses = options.fullResolutionPasses;
     }
 
     engine.setBuildSettings (buildSettings);
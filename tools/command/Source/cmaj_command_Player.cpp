@@ -77,6 +77,13 @@ void playFile (choc::ArgumentList& args,
     bool noGUI       = args.removeIfFound ("--no-gui");
     bool stopOnError = args.removeIfFound ("--stop-on-error");
     bool dryRun      = args.removeIfFound ("--dry-run");
+    bool tiered      = args.removeIfFound ("--tiered");
+    bool keepState   = args.removeIfFound ("--keep-state");
+
+    uint32_t reloadCrossfadeFrames = 1024;
+
+    if (auto frames = args.removeIntValue<uint32_t> ("--crossfade"))
+        reloadCrossfadeFrames = *frames;
 
     int64_t framesToRender = 0;
 
@@ -133,6 +140,8 @@ void playFile (choc::ArgumentList& args,
     {
         cmaj::PatchPlayer player (engineOptions, buildSettings, true);
         player.setAudioMIDIPlayer (std::move (audioPlayer));
+        player.patch.setTieredCompilation (tiered);
+        player.patch.setStatePreservingReload (keepState, reloadCrossfadeFrames);
         player.startPlayback();
         runPatch (player, file.string(), framesToRender, stopOnError);
     }
@@ -141,6 +150,8 @@ void playFile (choc::ArgumentList& args,
         choc::ui::setWindowsDPIAwareness();
         cmaj::PatchWindow patchWindow (engineOptions, buildSettings);
         patchWindow.player.setAudioMIDIPlayer (std::move (audioPlayer));
+        patchWindow.player.patch.setTieredCompilation (tiered);
+        patchWindow.player.patch.setStatePreservingReload (keepState, reloadCrossfadeFrames);
         runPatch (patchWindow.player, file.string(), framesToRender, stopOnError);
     }
 }
@@ -23,6 +23,7 @@
 #include "../../../modules/playback/include/cmaj_PatchPlayer.h"
 #include "../../../modules/playback/include/cmaj_AudioFileUtils.h"
 #include "../../../modules/playback/include/cmaj_RenderingAudioMIDIPlayer.h"
+#include "../../../include/cmajor/helpers/cmaj_FileBasedCacheDatabase.h"
 
 //==============================================================================
 struct RenderOptions
@@ -60,6 +61,9 @@ struct RenderOptions
 
         outputAudioFile = args.removeExistingFile ("--output").string();
 
+        if (auto folder = args.removeExistingFolderIfPresent ("--cache"))
+            cacheFolder = folder->string();
+
         auto files = args.getAllAsExistingFiles();
 
         if (files.size() != 1 || files[0].extension() != ".cmajorpatch")
@@ -68,7 +72,7 @@ struct RenderOptions
         patchFile = files[0].string();
     }
 
-    std::string patchFile, inputAudioFile, inputMIDIFile, outputAudioFile;
+    std::string patchFile, inputAudioFile, inputMIDIFile, outputAudioFile, cacheFolder;
     cmaj::audio_utils::AudioDeviceOptions audioOptions;
     uint64_t framesToRender = 0;
 };
@@ -155,6 +159,9 @@ struct RenderState
 
         patchPlayer.setAudioMIDIPlayer (audioMIDIPlayer);
 
+        if (! options.cacheFolder.empty())
+            patchPlayer.patch.cache = choc::com::create<cmaj::FileBasedCacheDatabase> (options.cacheFolder, 100);
+
         patchPlayer.onStatusChange = [] (const cmaj::Patch::Status& s)
         {
             if (s.messageList.hasErrors())
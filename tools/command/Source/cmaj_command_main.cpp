@@ -69,6 +69,14 @@ cmaj <command> [options]    Runs the given command. Options can include the foll
     --debug                 Turn on debug output from the performer
     --sessionID=n           Set the session id to the given value
     --eventBufferSize=n     Set the max number of events per buffer
+    --codeGenThreads=n      Split the LLVM module and optimise/compile the parts on n threads
+    --renderThreads=n       Render the instances of a multi-instance performer on up to n threads
+    --mathsAccuracy=<mode>  Vector sin/cos/exp/log/pow accuracy: exact (default), 1ulp or fast
+    --instrumentForProfiling  Build code that records branch counts into the cache (see render --cache)
+    --useProfile            Optimise using the branch counts recorded by an instrumented build
+    --freeze=<file>         Compile the inputs in this JSON file's object (endpoint ID -> value) as constants
+    --dynamicRate           Build code that can change sample rate and block size (up to --maxBlockSize) without recompiling
+    --maxBlockSize=n        Set the largest block size that the compiled code must handle
     --engine=<type>         Use the specified engine - e.g. llvm, webview, cpp
     --simd                  WASM generation uses SIMD/non-SIMD at runtime (default)
     --no-simd               WASM generation does not emit SIMD
@@ -91,6 +99,11 @@ cmaj play file [opts]       Plays a .cmajorpatch, or executes a .js javascript f
                             running and retry when files are modified)
     --dry-run               Doesn't attempt to play any audio, just builds the patch, emits
                             any errors that are found, and exits
+    --tiered                Starts playing a quickly-optimised build, then swaps in the fully
+                            optimised one when its background build has finished
+    --keep-state            When the patch's files change, carries over the state of any unchanged
+                            variables, and crossfades from the old build to the new one
+    --crossfade=<frames>    The length of the --keep-state crossfade (default 1024)
     --rate=<rate>           Use the specified sample rate
     --block-size=<size>     Request the given block size
 
@@ -119,6 +132,10 @@ cmaj render [opts] <file>   Renders the given file or patch
     --output=<file>         Write the output to the given file
     --input=<file>          Use input from the given file
     --midi=<file>           Use input MIDI data from the given file
+    --cache=<folder>        Use the given folder as the build cache, which is also where
+                            profile counts are kept when profiling. To do a profile-guided
+                            build, render with --instrumentForProfiling, then render again
+                            (or load the patch) using --useProfile and the same cache
 
 cmaj generate [opts] <file> Generates some code from the given file or patch
 
@@ -168,6 +185,41 @@ static cmaj::BuildSettings parseBuildArgs (choc::ArgumentList& args)
     if (auto bufferSize = args.removeIntValue<uint32_t> ("--eventBufferSize"))
         buildSettings.setEventBufferSize (*bufferSize);
 
+    if (auto numThreads = args.removeIntValue<uint32_t> ("--codeGenThreads"))
+        buildSettings.setCodeGenThreads (*numThreads);
+
+    if (auto numThreads = args.removeIntValue<uint32_t> ("--renderThreads"))
+        buildSettings.setRenderThreads (*numThreads);
+
+    if (auto accuracy = args.removeValueFor ("--mathsAccuracy"))
+        buildSettings.setMathsAccuracy (cmaj::BuildSettings::getMathsAccuracyFromName (*accuracy));
+
+    if (args.removeIfFound ("--instrumentForProfiling"))
+        buildSettings.setInstrumentForProfiling (true);
+
+    if (args.removeIfFound ("--useProfile"))
+        buildSettings.setUseProfileData (true);
+
+    if (args.removeIfFound ("--dynamicRate"))
+        buildSettings.setUseDynamicRate (true);
+
+    if (auto blockSize = args.removeIntValue<uint32_t> ("--maxBlockSize"))
+        buildSettings.setMaxBlockSize (*blockSize);
+
+    if (auto presetFile = args.removeExistingFileIfPresent ("--freeze"))
+    {
+        auto preset = choc::json::parse (choc::file::loadFileAsString (presetFile->string()));
+
+        if (! preset.isObject())
+            throw std::runtime_error ("The --freeze file must contain an object mapping endpoint IDs to values");
+
+        for (uint32_t i = 0; i < preset.size(); ++i)
+        {
+            auto member = preset.getObjectMemberAt (i);
+            buildSettings.setFrozenEndpointValue (member.name, member.value);
+        }
+    }
+
     return buildSettings;
 }
 
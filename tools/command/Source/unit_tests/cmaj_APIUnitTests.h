@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <cmath>
+#include <limits>
 #include <map>
 #include "cmajor/API/cmaj_Engine.h"
 
@@ -37,6 +39,33 @@ namespace cmaj::api_tests
         return false;
     }
 
+    /// A cache that keeps its entries in memory, so tests can check what gets stored
+    struct MemoryCache  : public choc::com::ObjectWithAtomicRefCount<CacheDatabaseInterface, MemoryCache>
+    {
+        void store (const char* key, const void* data, uint64_t size) override
+        {
+            auto start = static_cast<const char*> (data);
+            entries[key] = std::vector<char> (start, start + size);
+            ++numStores;
+        }
+
+        uint64_t reload (const char* key, void* dest, uint64_t destSize) override
+        {
+            auto entry = entries.find (key);
+
+            if (entry == entries.end())
+                return 0;
+
+            if (dest != nullptr && destSize >= entry->second.size())
+                memcpy (dest, entry->second.data(), entry->second.size());
+
+            return entry->second.size();
+        }
+
+        std::map<std::string, std::vector<char>> entries;
+        int numStores = 0;
+    };
+
     static std::string source()
     {
         return R"(
@@ -218,6 +247,24 @@ namespace cmaj::api_tests
         performer.copyOutputValue (out2Handle, std::addressof (out2Value));
         CHOC_EXPECT_NEAR (4.0f, out2Value, 0.0001);
 
+        // The same block again, rendered with a single processBlock call
+        CHOC_EXPECT_TRUE (performer.setBlockBindings ({ in1Handle, in2Handle }, { out1Handle, out2Handle }) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.setBlockBindings ({ out1Handle }, {}) == cmaj::Result::InvalidEndpointHandle);
+
+        auto in2Value = 3.0f;
+        outputBlock.clear();
+        out2Value = -1.0f;
+
+        const void* inputData[] = { inputBlock.getView().data.data, std::addressof (in2Value) };
+        void* outputData[] = { outputBlock.getView().data.data, std::addressof (out2Value) };
+        CHOC_EXPECT_TRUE (performer.processBlock (5, inputData, outputData) == cmaj::Result::Ok);
+
+        for (uint32_t i = 0; i < 5; i++)
+            CHOC_EXPECT_NEAR (float (i) * 2, outputBlock.getSample (0, i), 0.0001);
+
+        CHOC_EXPECT_NEAR (6.0f, out2Value, 0.0001);
+        CHOC_EXPECT_TRUE (performer.processBlock (100, inputData, outputData) == cmaj::Result::InvalidBlockSize);
+
         // Exceeds maxBlockSize = 10
         CHOC_EXPECT_TRUE ( performer.setBlockSize (100) == cmaj::Result::InvalidBlockSize );
     }
@@ -291,15 +338,988 @@ namespace cmaj::api_tests
         CHOC_EXPECT_EQ (value, int32_t {2});
     }
 
-    inline void checkExternalFunctions (choc::test::TestProgress& progress)
+    static void checkInputEventAtFrame (choc::test::TestProgress& progress)
     {
-        CHOC_TEST (checkExternalFunctions)
+        CHOC_TEST (checkInputEventAtFrame)
+
+        auto engine = cmaj::Engine::create ({});
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            graph G
+            {
+                input event int32 in;
+                output event int32 out;
+
+                connection in -> out;
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto inHandle = engine.getEndpointHandle ("in");
+        const auto outHandle = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (16)
+                                                      .setEventBufferSize (4));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer);
+
+        auto renderBlock = [&]
+        {
+            performer.advance();
+
+            std::string output;
+
+            performer.iterateOutputEvents (outHandle, [&] (auto, uint32_t, uint32_t frame, const void* data, uint32_t)
+            {
+                output += std::to_string (*reinterpret_cast<const int32_t*> (data)) + "@" + std::to_string (frame) + " ";
+                return true;
+            });
+
+            return output;
+        };
+
+        CHOC_EXPECT_TRUE (performer.supportsFrameOffsets());
+
+        performer.setBlockSize (16);
+        CHOC_EXPECT_TRUE (performer.addInputEventAtFrame (inHandle, 0, int32_t (3), 11) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.addInputEventAtFrame (inHandle, 0, int32_t (1), 0) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.addInputEventAtFrame (inHandle, 0, int32_t (2), 5) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.addInputEventAtFrame (inHandle, 1, int32_t (2), 5) == cmaj::Result::TypeIndexOutOfRange);
+        CHOC_EXPECT_EQ (renderBlock(), "1@0 2@5 3@11 ");
+
+        // Once a block's worth of events is queued, any more are dropped rather than delivered out of order
+        auto xrunsBefore = performer.getXRuns();
+
+        for (int32_t i = 1; i <= 5; ++i)
+            performer.addInputEventAtFrame (inHandle, 0, i, static_cast<uint32_t> ((6 - i) * 2));
+
+        CHOC_EXPECT_EQ (renderBlock(), "4@4 3@6 2@8 1@10 ");
+        CHOC_EXPECT_EQ (performer.getXRuns(), xrunsBefore + 1);
+    }
+
+    static void checkStateSnapshots (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkStateSnapshots)
+
+        auto engine = cmaj::Engine::create ({});
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                output stream int32 out;
+
+                void main()
+                {
+                    int32 counter;
+
+                    loop
+                    {
+                        out <- ++counter;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto outHandle = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (4));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer);
+
+        const auto renderBlock = [outHandle] (cmaj::Performer& p)
+        {
+            int32_t frames[4] = {};
+            p.setBlockSize (4);
+            p.advance();
+            p.copyOutputFrames (outHandle, frames, 4);
+            return std::to_string (frames[0]) + "-" + std::to_string (frames[3]);
+        };
+
+        renderBlock (performer);
+        auto snapshot = performer.createStateSnapshot();
+        CHOC_EXPECT_TRUE (! snapshot.empty());
+
+        auto copy = engine.createCopyOfPerformer (performer);
+        CHOC_EXPECT_TRUE (copy);
+
+        CHOC_EXPECT_EQ (renderBlock (performer), "5-8");
+        CHOC_EXPECT_EQ (renderBlock (copy), "5-8");
+        CHOC_EXPECT_EQ (renderBlock (copy), "9-12");
+
+        CHOC_EXPECT_TRUE (performer.restoreStateSnapshot (snapshot) == cmaj::Result::Ok);
+        CHOC_EXPECT_EQ (renderBlock (performer), "5-8");
+        CHOC_EXPECT_TRUE (performer.restoreStateSnapshot ({}) == cmaj::Result::InvalidState);
+    }
+
+    static void checkMultiInstancePerformer (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkMultiInstancePerformer)
+
+        auto engine = cmaj::Engine::create ({});
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input value float gain;
+                output stream float out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- gain;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto gainHandle = engine.getEndpointHandle ("gain");
+        const auto outHandle = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (4)
+                                                      .setRenderThreads (2));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        constexpr uint32_t numInstances = 3;
+        auto performer = engine.createMultiInstancePerformer (numInstances);
+        CHOC_EXPECT_TRUE (performer);
+
+        CHOC_EXPECT_EQ (performer.getEndpointHandleForInstance (outHandle, 0), outHandle);
+        CHOC_EXPECT_EQ (performer.getEndpointHandleForInstance (outHandle, numInstances), cmaj::EndpointHandle());
+
+        for (uint32_t i = 0; i < numInstances; ++i)
+            performer.setInputValue (performer.getEndpointHandleForInstance (gainHandle, i), static_cast<float> (i + 1), 0);
+
+        performer.setBlockSize (4);
+        performer.advance();
+
+        std::string output;
+
+        for (uint32_t i = 0; i < numInstances; ++i)
+        {
+            float frames[4] = {};
+            performer.copyOutputFrames (performer.getEndpointHandleForInstance (outHandle, i), frames, 4);
+            output += std::to_string (static_cast<int> (frames[0])) + std::to_string (static_cast<int> (frames[3]));
+        }
+
+        CHOC_EXPECT_EQ (output, "112233");
+    }
+
+    static void checkSilentInputFrames (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkSilentInputFrames)
+
+        auto engine = cmaj::Engine::create ({});
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float in;
+                output stream float out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto inHandle = engine.getEndpointHandle ("in");
+        const auto outHandle = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (8));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer);
+
+        auto render = [&] (const float* input, uint32_t numFrames)
+        {
+            float frames[8] = {};
+            performer.setBlockSize (numFrames);
+            performer.setInputFrames (inHandle, input, numFrames);
+            performer.advance();
+            performer.copyOutputFrames (outHandle, frames, numFrames);
+
+            std::string result;
+
+            for (uint32_t i = 0; i < numFrames; ++i)
+                result += std::to_string (static_cast<int> (frames[i]));
+
+            return result;
+        };
+
+        const float data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+        CHOC_EXPECT_EQ (render (data, 8), "12345678");
+        CHOC_EXPECT_EQ (render (nullptr, 4), "0000");
+        // the silent region has to grow if the block size does
+        CHOC_EXPECT_EQ (render (nullptr, 8), "00000000");
+        CHOC_EXPECT_EQ (render (data, 4), "1234");
+        CHOC_EXPECT_EQ (render (nullptr, 4), "0000");
+
+        // processBlock treats a null stream input in the same way
+        CHOC_EXPECT_TRUE (performer.setBlockBindings ({ inHandle }, { outHandle }) == cmaj::Result::Ok);
+
+        auto processBlock = [&] (const float* input, uint32_t numFrames)
+        {
+            float frames[8] = {};
+            const void* inputData[] = { input };
+            void* outputData[] = { frames };
+            CHOC_EXPECT_TRUE (performer.processBlock (numFrames, inputData, outputData) == cmaj::Result::Ok);
+
+            std::string result;
+
+            for (uint32_t i = 0; i < numFrames; ++i)
+                result += std::to_string (static_cast<int> (frames[i]));
+
+            return result;
+        };
+
+        CHOC_EXPECT_EQ (processBlock (data, 4), "1234");
+        CHOC_EXPECT_EQ (processBlock (nullptr, 4), "0000");
+    }
+
+    static void checkProfileGuidedBuild (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkProfileGuidedBuild)
+
+        auto cache = choc::com::create<MemoryCache>();
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float in;
+                output stream float out;
+
+                void main()
+                {
+                    loop
+                    {
+                        if (in > 0.9f)
+                            out <- 2.0f;
+                        else
+                            out <- 1.0f;
+
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        auto buildAndRender = [&] (const cmaj::BuildSettings& settings)
+        {
+            auto engine = cmaj::Engine::create ("llvm");
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            const auto inHandle = engine.getEndpointHandle ("in");
+            const auto outHandle = engine.getEndpointHandle ("out");
+
+            engine.setBuildSettings (settings);
+            CHOC_EXPECT_TRUE (engine.link (messages, cache.get()));
+
+            auto performer = engine.createPerformer();
+            const float input[4] = { 0, 1, 0, 0 };
+            float output[4] = {};
+
+            performer.setBlockSize (4);
+            performer.setInputFrames (inHandle, input, 4);
+            performer.advance();
+            performer.copyOutputFrames (outHandle, output, 4);
+
+            std::string result;
+
+            for (auto f : output)
+                result += std::to_string (static_cast<int> (f));
+
+            return result;
+        };
+
+        auto getNumProfiles = [&]
+        {
+            int num = 0;
+
+            for (auto& e : cache->entries)
+                if (choc::text::endsWith (e.first, "_profile"))
+                    ++num;
+
+            return num;
+        };
+
+        auto getNumCodeEntries = [&]
+        {
+            return static_cast<int> (cache->entries.size()) - getNumProfiles();
+        };
+
+        auto settings = cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (4);
+
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setInstrumentForProfiling (true)), "1211");
+        CHOC_EXPECT_EQ (getNumProfiles(), 1);
+
+        // a second instrumented run adds to the same profile
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setInstrumentForProfiling (true)), "1211");
+        CHOC_EXPECT_EQ (getNumProfiles(), 1);
+
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setUseProfileData (true)), "1211");
+
+        // rebuilding with the same profile reuses the cached code..
+        auto numCodeEntries = getNumCodeEntries();
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setUseProfileData (true)), "1211");
+        CHOC_EXPECT_EQ (getNumCodeEntries(), numCodeEntries);
+
+        // ..but once the profile has changed, the code is built again rather than reused
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setInstrumentForProfiling (true)), "1211");
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setUseProfileData (true)), "1211");
+        CHOC_EXPECT_TRUE (getNumCodeEntries() > numCodeEntries);
+    }
+
+    static void checkFrozenEndpoints (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkFrozenEndpoints)
+
+        const auto source = R"(
+            graph G [[ main ]]
+            {
+                input value float gain;
+                input event int mode;
+                output stream float out;
+
+                node p = P;
+
+                connection
+                {
+                    gain -> p.gain;
+                    mode -> p.mode;
+                    p.out -> out;
+                }
+            }
+
+            processor P
+            {
+                input value float gain;
+                input event int mode;
+                output stream float out;
+
+                int currentMode;
+
+                event mode (int m)  { currentMode = m; }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- (currentMode == 1 ? gain * 2.0f : gain);
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        auto buildAndRender = [&] (const cmaj::BuildSettings& settings) -> std::string
+        {
+            auto engine = cmaj::Engine::create ({});
+            engine.setBuildSettings (settings);
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            // frozen endpoints are no longer part of the program's interface
+            CHOC_EXPECT_EQ (engine.getEndpointHandle ("gain"), cmaj::EndpointHandle());
+
+            const auto outHandle = engine.getEndpointHandle ("out");
+
+            if (! engine.link (messages, {}))
+                return "error";
+
+            auto performer = engine.createPerformer();
+            float output[4] = {};
+
+            performer.setBlockSize (4);
+            performer.advance();
+            performer.copyOutputFrames (outHandle, output, 4);
+
+            std::string result;
+
+            for (auto f : output)
+                result += std::to_string (static_cast<int> (f));
+
+            return result;
+        };
+
+        auto settings = cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (4);
+
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setFrozenEndpointValue ("gain", choc::value::createFloat32 (3.0f))
+                                                                      .setFrozenEndpointValue ("mode", choc::value::createInt32 (1))), "6666");
+
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setFrozenEndpointValue ("gain", choc::value::createFloat32 (3.0f))
+                                                                      .setFrozenEndpointValue ("mode", choc::value::createInt32 (0))), "3333");
+
+        CHOC_EXPECT_EQ (buildAndRender (cmaj::BuildSettings (settings).setFrozenEndpointValue ("gain", choc::value::createFloat32 (3.0f))
+                                                                      .setFrozenEndpointValue ("unknown", choc::value::createInt32 (0))), "error");
+    }
+
+    static void checkDynamicRate (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkDynamicRate)
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        program.parse (messages, "", R"(
+            processor P [[ main ]]
+            {
+                output stream float out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- float (processor.frequency);
+                        advance();
+                    }
+                }
+            }
+        )");
 
         auto engine = cmaj::Engine::create ("llvm");
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (8).setUseDynamicRate (true));
+
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+        const auto outHandle = engine.getEndpointHandle ("out");
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        auto render = [&]
+        {
+            auto performer = engine.createPerformer();
+            CHOC_EXPECT_EQ (performer.getMaximumBlockSize(), 8u);
+
+            float output[4] = {};
+            performer.setBlockSize (4);
+            performer.advance();
+            performer.copyOutputFrames (outHandle, output, 4);
+            return static_cast<int> (output[3]);
+        };
+
+        CHOC_EXPECT_EQ (render(), 44100);
+
+        // The linked code is re-used, and the block size it was built for still applies
+        engine.setBuildSettings (engine.getBuildSettings().setFrequency (48000.0).setMaxBlockSize (16));
+        CHOC_EXPECT_TRUE (engine.isLinked());
+        CHOC_EXPECT_EQ (render(), 48000);
+    }
+
+    static void checkStateMigration (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkStateMigration)
+
+        struct Build
+        {
+            cmaj::Engine engine = cmaj::Engine::create ("llvm");
+            cmaj::Performer performer;
+            cmaj::EndpointHandle outHandle = {};
+        };
+
+        auto build = [&] (Build& b, const char* source)
+        {
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            b.engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (4));
+            CHOC_EXPECT_TRUE (b.engine.load (messages, program, {}, {}));
+            b.outHandle = b.engine.getEndpointHandle ("out");
+            CHOC_EXPECT_TRUE (b.engine.link (messages, {}));
+            b.performer = b.engine.createPerformer();
+            b.performer.setBlockSize (4);
+        };
+
+        auto render = [] (Build& b)
+        {
+            float output[4] = {};
+            b.performer.advance();
+            b.performer.copyOutputFrames (b.outHandle, output, 4);
+            return static_cast<int> (output[3]);
+        };
+
+        Build oldVersion, newVersion;
+
+        build (oldVersion, R"(
+            processor P [[ main ]]
+            {
+                output stream float out;
+                int count;
+                float level = 1.0f;
+
+                void main()  { loop { ++count; level *= 1.0f; out <- float (count) * level; advance(); } }
+            }
+        )");
+
+        CHOC_EXPECT_EQ (render (oldVersion), 4);
+        CHOC_EXPECT_EQ (render (oldVersion), 8);
+
+        // The counter carries over, the new variable keeps its initial value, and
+        // the variable whose type has changed isn't copied
+        build (newVersion, R"(
+            processor P [[ main ]]
+            {
+                output stream float out;
+                int extra = 1000;
+                int count;
+                int level = 2;
+
+                void main()  { loop { ++count; level *= 1; extra += 0; out <- float (count * level + extra); advance(); } }
+            }
+        )");
+
+        CHOC_EXPECT_TRUE (newVersion.performer.getStateLayout().isObject());
+        CHOC_EXPECT_TRUE (newVersion.performer.copyMatchingStateFrom (oldVersion.performer) == cmaj::Result::Ok);
+        CHOC_EXPECT_EQ (render (newVersion), 1024);
+
+        // The members of internal nodes such as delays are left out, as their names depend on
+        // the order in which the compiler created them
+        Build graphVersion;
+
+        build (graphVersion, R"(
+            graph G [[ main ]]
+            {
+                output stream float out;
+                node p = P;
+                connection p.out -> [2] -> out;
+            }
+
+            processor P
+            {
+                output stream float out;
+                int count;
+
+                void main()  { loop { ++count; out <- float (count); advance(); } }
+            }
+        )");
+
+        auto layout = graphVersion.performer.getStateLayout();
+        bool foundCount = false;
+
+        for (uint32_t i = 0; i < layout["variables"].size(); ++i)
+        {
+            auto name = std::string (layout["variables"][i]["name"].getString());
+            CHOC_EXPECT_TRUE (name.find ("_") != 0 && name.find ("._") == std::string::npos);
+
+            if (name.find ("count") != std::string::npos)
+                foundCount = true;
+        }
+
+        CHOC_EXPECT_TRUE (foundCount);
+    }
+
+    static void checkParseCache (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkParseCache)
+
+        const auto processorSource = R"(processor P [[ main ]]
+{
+    output stream float out;
+
+    void main()  { loop { out <- constants::level; advance(); } }
+}
+)";
+
+        auto load = [&] (const char* constantsSource)
+        {
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "processor.cmajor", processorSource);
+            program.parse (messages, "constants.cmajor", constantsSource);
+
+            auto engine = cmaj::Engine::create ("llvm");
+            engine.load (messages, program, {}, {});
+            return messages;
+        };
+
+        CHOC_EXPECT_FALSE (load ("namespace constants { let level = 0.5f; }").hasErrors());
+        CHOC_EXPECT_FALSE (load ("namespace constants { let level = 0.25f; }").hasErrors());
+
+        // The unchanged file is re-created from the cache, but errors in it must still have their locations
+        auto messages = load ("namespace constants { let volume = 0.5f; }");
+        CHOC_EXPECT_TRUE (messages.hasErrors());
+        CHOC_EXPECT_TRUE (choc::text::contains (messages.toString(), "processor.cmajor:5:"));
+    }
+
+    static void checkResolutionPassModes (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkResolutionPassModes)
+
+        auto render = [&] (const char* source, bool fullResolutionPasses)
+        {
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+
+            auto engine = cmaj::Engine::create ("llvm");
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (4)
+                                                          .setUseFullResolutionPasses (fullResolutionPasses));
+
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+            auto outHandle = engine.getEndpointHandle ("out");
+            CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+            auto performer = engine.createPerformer();
+            float output[4] = {};
+            performer.setBlockSize (4);
+            performer.advance();
+            performer.copyOutputFrames (outHandle, output, 4);
+            return output[3];
+        };
+
+        const auto source = R"(
+            graph G [[ main ]]
+            {
+                output stream float out;
+                node source = Source (2);
+                connection source -> out;
+            }
+
+            processor Source (int scale)
+            {
+                output stream float out;
+
+                T addOne<T> (T v)   { return v + T (1); }
+
+                void main()  { loop { out <- float (A::x * scale) + addOne (0.5f) + std::notes::noteToFrequency (69); advance(); } }
+            }
+
+            namespace A { let x = B::y * 2; }
+            namespace B { let y = C::z + 1; }
+            namespace C { let z = 3; }
+        )";
+
+        CHOC_EXPECT_NEAR (457.5f, render (source, true), 0.001);
+        CHOC_EXPECT_NEAR (457.5f, render (source, false), 0.001);
+
+        // The specialisation of Source is only created once the frequency is known, after the
+        // modules that existed at the start of that round have already been resolved
+        const auto sourceUsingFrequency = R"(
+            graph G [[ main ]]
+            {
+                output stream float out;
+                node source = Source (float (processor.frequency) / 100.0f);
+                connection source -> out;
+            }
+
+            processor Source (float level)
+            {
+                output stream float out;
+                void main()  { loop { out <- level; advance(); } }
+            }
+        )";
+
+        CHOC_EXPECT_NEAR (441.0f, render (sourceUsingFrequency, true), 0.001);
+        CHOC_EXPECT_NEAR (441.0f, render (sourceUsingFrequency, false), 0.001);
+    }
+
+    static void checkStandardLibrarySubsets (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkStandardLibrarySubsets)
+
+        auto render = [&] (const char* source)
+        {
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+
+            auto engine = cmaj::Engine::create ("llvm");
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (4));
+
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+            auto outHandle = engine.getEndpointHandle ("out");
+            CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+            auto performer = engine.createPerformer();
+            float output[4] = {};
+            performer.setBlockSize (4);
+            performer.advance();
+            performer.copyOutputFrames (outHandle, output, 4);
+            return output[3];
+        };
+
+        // Only uses the intrinsics, so gets the smallest subset of the library
+        CHOC_EXPECT_NEAR (1.0f, render (R"(
+            processor P [[ main ]]
+            {
+                output stream float out;
+                void main()  { loop { out <- float (cos (0.0)); advance(); } }
+            }
+        )"), 0.001);
+
+        // Reaches a library namespace through an alias
+        CHOC_EXPECT_NEAR (440.0f, render (R"(
+            namespace test
+            {
+                namespace n = std::notes;
+
+                processor P [[ main ]]
+                {
+                    output stream float out;
+                    void main()  { loop { out <- n::noteToFrequency (69); advance(); } }
+                }
+            }
+        )"), 0.001);
+    }
+
+    //==============================================================================
+    /// Renders sin, cos, exp, log, log10 and pow of each lane of the given inputs, using
+    /// vectors so that the maths kernels for the given accuracy mode are used.
+    template <typename FloatType>
+    static std::vector<std::vector<FloatType>> renderVectorMaths (choc::test::TestProgress& progress,
+                                                                  cmaj::BuildSettings::MathsAccuracy accuracy,
+                                                                  const std::vector<FloatType>& x, const std::vector<FloatType>& y)
+    {
+        constexpr uint32_t numLanes = 8;
+        auto numFrames = static_cast<uint32_t> (x.size() / numLanes);
+
+        auto source = choc::text::replace (R"(
+            processor P
+            {
+                input stream FloatType<8> x, y;
+                output stream FloatType<8> sinOut, cosOut, expOut, logOut, log10Out, powOut;
+
+                void main()
+                {
+                    loop
+                    {
+                        sinOut <- sin (x);
+                        cosOut <- cos (x);
+                        expOut <- exp (x);
+                        logOut <- log (x);
+                        log10Out <- log10 (x);
+                        powOut <- pow (x, y);
+                        advance();
+                    }
+                }
+            }
+        )", "FloatType", std::is_same<FloatType, float>::value ? "float32" : "float64");
 
         cmaj::Program program;
         cmaj::DiagnosticMessageList messages;
 
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+
+        auto engine = cmaj::Engine::create ({});
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        auto xHandle = engine.getEndpointHandle ("x");
+        auto yHandle = engine.getEndpointHandle ("y");
+        std::vector<cmaj::EndpointHandle> outputHandles;
+
+        for (auto name : { "sinOut", "cosOut", "expOut", "logOut", "log10Out", "powOut" })
+            outputHandles.push_back (engine.getEndpointHandle (name));
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (numFrames)
+                                                      .setMathsAccuracy (accuracy));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        auto performer = engine.createPerformer();
+        performer.setBlockSize (numFrames);
+        performer.setInputFrames (xHandle, x.data(), numFrames);
+        performer.setInputFrames (yHandle, y.data(), numFrames);
+        performer.advance();
+
+        std::vector<std::vector<FloatType>> results;
+
+        for (auto handle : outputHandles)
+        {
+            results.emplace_back (x.size());
+            performer.copyOutputFrames (handle, results.back().data(), numFrames);
+        }
+
+        return results;
+    }
+
+    /// Compares the "1ulp" and "fast" kernels with the library versions that "exact" uses.
+    template <typename FloatType>
+    static void checkVectorMathsKernels (choc::test::TestProgress& progress)
+    {
+        using Accuracy = cmaj::BuildSettings::MathsAccuracy;
+        using Limits = std::numeric_limits<FloatType>;
+        constexpr bool isFloat32 = std::is_same<FloatType, float>::value;
+        const char* functionNames[] = { "sin", "cos", "exp", "log", "log10", "pow" };
+
+        // Special values: every pair of these is passed to pow, and each one to the other functions
+        const FloatType specialValues[] = { Limits::quiet_NaN(), Limits::infinity(), -Limits::infinity(),
+                                            FloatType (0), -FloatType (0), Limits::denorm_min(), -Limits::denorm_min(),
+                                            Limits::min() / 4, FloatType (1), FloatType (-1), FloatType (2), FloatType (-2),
+                                            FloatType (0.5), FloatType (-8), FloatType (100), FloatType (-100) };
+
+        std::vector<FloatType> specialX, specialY;
+
+        for (auto a : specialValues)
+        {
+            for (auto b : specialValues)
+            {
+                specialX.push_back (a);
+                specialY.push_back (b);
+            }
+        }
+
+        auto expectedSpecials = renderVectorMaths (progress, Accuracy::exact, specialX, specialY);
+
+        for (auto accuracy : { Accuracy::oneULP, Accuracy::fast })
+        {
+            auto results = renderVectorMaths (progress, accuracy, specialX, specialY);
+
+            for (size_t fn = 0; fn < results.size(); ++fn)
+            {
+                for (size_t i = 0; i < specialX.size(); ++i)
+                {
+                    auto expected = expectedSpecials[fn][i];
+                    auto actual = results[fn][i];
+
+                    bool ok = std::isnan (expected) ? std::isnan (actual)
+                                : std::isinf (expected) ? actual == expected
+                                : expected == 0 ? (actual == 0 && std::signbit (actual) == std::signbit (expected))
+                                : (std::isfinite (actual) && std::signbit (actual) == std::signbit (expected)
+                                     && (actual != 0 || std::abs (expected) < Limits::min()));
+
+                    if (! ok)
+                    {
+                        CHOC_FAIL (std::string (functionNames[fn]) + " (" + std::to_string (specialX[i])
+                                     + (fn == 5 ? ", " + std::to_string (specialY[i]) : std::string())
+                                     + ") gave " + std::to_string (actual) + ", expected " + std::to_string (expected));
+                    }
+                }
+            }
+        }
+
+        // Error bounds over typical ranges, measured in multiples of the float32 epsilon relative
+        // to the library's result. Functions which cross zero use a minimum magnitude of 1, because
+        // near a root, an error of an ulp in the input gives a far larger error in ulps of the result.
+        constexpr uint32_t numValues = 4096;
+        auto maxExponent = isFloat32 ? 30.0 : 300.0;
+        auto expRange = isFloat32 ? 80.0 : 700.0;
+
+        std::vector<FloatType> sinCosX, expX, logX, powX, powY;
+
+        for (uint32_t i = 0; i < numValues; ++i)
+        {
+            auto t = (i + 0.5) / numValues;
+            auto scrambled = std::fmod (i * 0.6180339887498949, 1.0);
+
+            sinCosX.push_back (static_cast<FloatType> (-100.0 + 200.0 * t));
+            expX.push_back (static_cast<FloatType> (expRange * (2.0 * t - 1.0)));
+            logX.push_back (static_cast<FloatType> (std::pow (10.0, maxExponent * (2.0 * t - 1.0))));
+            powX.push_back (static_cast<FloatType> (std::pow (10.0, 4.0 * t - 2.0)));
+            powY.push_back (static_cast<FloatType> (8.0 * scrambled - 4.0));
+        }
+
+        struct Range
+        {
+            size_t function;
+            const std::vector<FloatType>& x;
+            const std::vector<FloatType>& y;
+            double minMagnitude, fastTolerance;
+        };
+
+        // Errors in pow's log are multiplied by the exponent, so the fast mode is much looser for it
+        const Range ranges[] = { { 0, sinCosX, powY, 1.0, 8.0 },
+                                 { 1, sinCosX, powY, 1.0, 8.0 },
+                                 { 2, expX,    powY, 0.0, 8.0 },
+                                 { 3, logX,    powY, 1.0, 8.0 },
+                                 { 4, logX,    powY, 1.0, 8.0 },
+                                 { 5, powX,    powY, 0.0, 64.0 } };
+
+        for (auto& range : ranges)
+        {
+            auto expected = renderVectorMaths (progress, Accuracy::exact, range.x, range.y)[range.function];
+
+            for (auto accuracy : { Accuracy::oneULP, Accuracy::fast })
+            {
+                auto actual = renderVectorMaths (progress, accuracy, range.x, range.y)[range.function];
+                auto tolerance = accuracy == Accuracy::fast ? range.fastTolerance : 2.0;
+                double maxError = 0;
+
+                for (size_t i = 0; i < numValues; ++i)
+                {
+                    auto e = static_cast<double> (expected[i]);
+                    auto a = static_cast<double> (actual[i]);
+                    auto scale = std::max (std::abs (e), range.minMagnitude) * std::numeric_limits<float>::epsilon();
+                    maxError = std::max (maxError, std::abs (a - e) / scale);
+                }
+
+                if (! (maxError <= tolerance))
+                    CHOC_FAIL (std::string (functionNames[range.function]) + " has an error of " + std::to_string (maxError)
+                                 + " epsilons in " + std::string (cmaj::BuildSettings::getMathsAccuracyName (accuracy)) + " mode");
+            }
+        }
+    }
+
+    static void checkVectorMathsAccuracy (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkVectorMathsAccuracy)
+
+        checkVectorMathsKernels<float> (progress);
+        checkVectorMathsKernels<double> (progress);
+    }
+
+    inline void checkExternalFunctions (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkExternalFunctions)
+
         const auto source = R"(
             processor P
             {
@@ -325,11 +1345,6 @@ namespace cmaj::api_tests
             }
         )";
 
-        program.parse (messages, "", source);
-        CHOC_EXPECT_TRUE (messages.empty());
-
-        std::vector<std::string> requestedExternals;
-
         struct Fns
         {
             static int32_t add1_32 (int32_t a, int32_t b)   { return a + b; }
@@ -349,53 +1364,78 @@ namespace cmaj::api_tests
             }
         };
 
-        bool result = engine.load (messages, program, {},
-            [&] (const char* fnName, choc::span<choc::value::Type> paramTypes) -> void*
-            {
-                auto name = std::string_view (fnName);
-                requestedExternals.push_back (std::string (name));
-                CMAJ_ASSERT (paramTypes.size() == 2);
+        auto cache = choc::com::create<MemoryCache>();
 
-                if (choc::text::contains (name, "add1"))
-                    return paramTypes[0].isInt32() ? (void*) Fns::add1_32 : (void*) Fns::add1_64;
+        auto buildAndRun = [&] (bool useObjectCache)
+        {
+            auto engine = cmaj::Engine::create ("llvm");
 
-                if (choc::text::contains (name, "add2"))
-                    return paramTypes[0].isFloat32() ? (void*) Fns::add2_32 : (void*) Fns::add2_64;
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
 
-                if (choc::text::contains (name, "testBools"))
-                    return (void*) Fns::testBools;
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (messages.empty());
 
-                if (choc::text::contains (name, "sum"))
-                    return (void*) Fns::sum;
+            std::vector<std::string> requestedExternals;
 
-                return {};
-            });
+            bool result = engine.load (messages, program, {},
+                [&] (const char* fnName, choc::span<choc::value::Type> paramTypes) -> void*
+                {
+                    auto name = std::string_view (fnName);
+                    requestedExternals.push_back (std::string (name));
+                    CMAJ_ASSERT (paramTypes.size() == 2);
 
-        CHOC_EXPECT_TRUE (result);
-        CHOC_EXPECT_TRUE (messages.empty());
+                    if (choc::text::contains (name, "add1"))
+                        return paramTypes[0].isInt32() ? (void*) Fns::add1_32 : (void*) Fns::add1_64;
 
-        const auto outHandle = engine.getEndpointHandle ("out");
+                    if (choc::text::contains (name, "add2"))
+                        return paramTypes[0].isFloat32() ? (void*) Fns::add2_32 : (void*) Fns::add2_64;
 
-        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
-                                                      .setMaxBlockSize (1));
+                    if (choc::text::contains (name, "testBools"))
+                        return (void*) Fns::testBools;
 
-        CHOC_EXPECT_TRUE (engine.link (messages, {}));
-        CHOC_EXPECT_TRUE (messages.empty());
-        auto performer = engine.createPerformer();
-        CHOC_EXPECT_TRUE (performer);
-        CHOC_EXPECT_TRUE (requestedExternals.size() == 6);
+                    if (choc::text::contains (name, "sum"))
+                        return (void*) Fns::sum;
 
-        performer.setBlockSize (1);
-        performer.advance();
-        std::string output;
+                    return {};
+                });
 
-        performer.iterateOutputEvents (outHandle, [&] (auto, uint32_t, uint32_t, const void* data, uint32_t)
-        {
-            output += std::to_string (*reinterpret_cast<const int32_t*> (data));
-            return true;
-        });
+            CHOC_EXPECT_TRUE (result);
+            CHOC_EXPECT_TRUE (messages.empty());
+
+            const auto outHandle = engine.getEndpointHandle ("out");
+
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                          .setMaxBlockSize (1)
+                                                          .setCacheObjectCode (useObjectCache));
+
+            CHOC_EXPECT_TRUE (engine.link (messages, useObjectCache ? cache.get() : nullptr));
+            CHOC_EXPECT_TRUE (messages.empty());
+            auto performer = engine.createPerformer();
+            CHOC_EXPECT_TRUE (performer);
+            CHOC_EXPECT_TRUE (requestedExternals.size() == 6);
+
+            performer.setBlockSize (1);
+            performer.advance();
+            std::string output;
+
+            performer.iterateOutputEvents (outHandle, [&] (auto, uint32_t, uint32_t, const void* data, uint32_t)
+            {
+                output += std::to_string (*reinterpret_cast<const int32_t*> (data));
+                return true;
+            });
+
+            CHOC_EXPECT_EQ (output, "111111");
+        };
+
+        buildAndRun (false);
+
+        buildAndRun (true);
+        CHOC_EXPECT_EQ (cache->numStores, 1);
 
-        CHOC_EXPECT_EQ (output, "111111");
+        // This build reloads the object code, so must bind the host functions without the code generator
+        buildAndRun (true);
+        CHOC_EXPECT_EQ (cache->numStores, 1);
     }
 
     static void runUnitTests (choc::test::TestProgress& progress)
@@ -405,6 +1445,18 @@ namespace cmaj::api_tests
         checkExternalFunctions (progress);
         checkGraph (progress);
         checkOutputEventWithMultipleTypes (progress);
+        checkInputEventAtFrame (progress);
+        checkStateSnapshots (progress);
+        checkMultiInstancePerformer (progress);
+        checkSilentInputFrames (progress);
+        checkProfileGuidedBuild (progress);
+        checkFrozenEndpoints (progress);
+        checkDynamicRate (progress);
+        checkStateMigration (progress);
+        checkParseCache (progress);
+        checkResolutionPassModes (progress);
+        checkStandardLibrarySubsets (progress);
+        checkVectorMathsAccuracy (progress);
         checkInvalidEngine (progress);
     }
 }